@@ -0,0 +1,374 @@
+// Headless benchmark: renders N frames per resolution/mode without touching the terminal and
+// reports per-stage timings as JSON or CSV.
+//
+//   benchmark [--frames N] [--warmup N] [--sizes 150x50,400x120] [--modes scalar,simd,cache]
+//             [--threads N] [--format json|csv]
+//   benchmark --bodies 1,10,100,1000 [--sizes 150x50] [--frames N] [--format json|csv]
+//
+// A mode is a '+' separated list of renderer options: scalar (the default path), simd, cache,
+// mipmap, delta, mono, aa, float, fixed, lanes4 / lanes8 (simd packet size, 16 otherwise),
+// profile (stage timers on, to see what they cost),
+// incremental (only the globe's footprint is cleared and ray-cast),
+// half (rendered at half the size each way and stretched back up when encoding).
+// e.g. --modes scalar,simd+cache,cache+delta,float. Any other option is an error.
+//
+// --bodies measures scene intersection instead: one camera ray per cell of the first size,
+// against a planet plus a debris field of n-1 rocks, through the BVH and by testing every body.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ascii_renderer.h"
+#include "earth.h"
+#include "scene.h"
+
+struct BenchConfig {
+    int frames = 200;
+    int warmup = 10;
+    int threads = 1;
+    std::string format = "json";
+    std::vector<std::pair<int, int>> sizes = {{150, 50}, {400, 120}, {800, 240}};
+    std::vector<std::string> modes = {"scalar", "simd", "cache", "cache+delta"};
+    std::vector<int> bodies;
+};
+
+struct Stats {
+    double min, median, p99, mean;
+};
+
+static const char* MODE_OPTIONS[] = {"scalar", "simd", "cache", "mipmap", "delta", "mono", "aa", "float", "fixed",
+                                     "lanes4", "lanes8", "profile", "incremental", "half"};
+
+static const char* STAGES[] = {"clear", "stars", "pixels", "encode", "total"};
+constexpr int STAGE_COUNT = 5;
+
+struct BenchResult {
+    int width, height;
+    std::string mode;
+    int threads;
+    int frames;
+    Stats stages[STAGE_COUNT];  // microseconds
+    Stats bytes;
+    int renderWidth, renderHeight;  // smaller than width x height in the half mode
+    double pixelsPerSecond;         // cells actually rendered
+    double outputPixelsPerSecond;   // cells sent, the same unless the render is scaled
+};
+
+static void printUsage() {
+    std::fprintf(stderr,
+                 "usage: benchmark [--frames N] [--warmup N] [--sizes WxH,...] [--modes MODE,...]\n"
+                 "                 [--threads N] [--format json|csv]\n"
+                 "       benchmark --bodies N,... [--sizes WxH] [--frames N] [--format json|csv]\n"
+                 "MODE is a '+' separated list of:");
+    for (const char* option : MODE_OPTIONS) std::fprintf(stderr, " %s", option);
+    std::fprintf(stderr, "\n");
+}
+
+static std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+// The first option of the mode that isn't one of MODE_OPTIONS, empty if they all are (a mode
+// without any options is unknown as a whole)
+static std::string unknownModeOption(const std::string& mode) {
+    std::vector<std::string> options = split(mode, '+');
+    if (options.empty()) return mode;
+    for (const std::string& option : options) {
+        if (std::find(std::begin(MODE_OPTIONS), std::end(MODE_OPTIONS), option) == std::end(MODE_OPTIONS)) return option;
+    }
+    return std::string();
+}
+
+static Stats summarize(std::vector<double> values) {
+    Stats stats = {0, 0, 0, 0};
+    if (values.empty()) return stats;
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    stats.min = values[0];
+    stats.median = values[n / 2];
+    stats.p99 = values[std::min(n - 1, static_cast<size_t>(std::ceil(n * 0.99)) - 1)];
+    double sum = 0;
+    for (double v : values) sum += v;
+    stats.mean = sum / n;
+    return stats;
+}
+
+static BenchResult runBenchmark(int width, int height, const std::string& mode, const BenchConfig& config) {
+    std::vector<std::string> options = split(mode, '+');
+    auto has = [&](const char* name) { return std::find(options.begin(), options.end(), name) != options.end(); };
+
+    ASCIIRenderer renderer(width, height, !has("mono"));
+    renderer.setThreadCount(config.threads);
+    renderer.setPacketTracing(has("simd"));
+    if (has("lanes4")) renderer.setPacketSize(4);
+    if (has("lanes8")) renderer.setPacketSize(8);
+    renderer.setGeometryCache(has("cache"));
+    renderer.setTextureMipmapping(has("mipmap"));
+    renderer.setDeltaOutput(has("delta"));
+    renderer.setAntialiasing(has("aa"));
+    if (has("float")) renderer.setPrecision(RenderPrecision::Float);
+    if (has("fixed")) renderer.setPrecision(RenderPrecision::Fixed);
+    renderer.getProfiler().setEnabled(has("profile"));
+    if (has("half")) renderer.setRenderScale(0.5);
+    bool incremental = has("incremental");
+    renderer.setIncremental(incremental);
+    Earth earth(3.0, Vec3(0, 0, 0));
+
+    typedef std::chrono::steady_clock Clock;
+    auto micros = [](Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::micro>(to - from).count();
+    };
+
+    std::vector<double> samples[STAGE_COUNT];
+    std::vector<double> bytes;
+    for (int frame = 0; frame < config.warmup + config.frames; frame++) {
+        // Incremental clears and redraws the footprint only, timed in the same buckets
+        ASCIIRenderer::IncrementalStep step;
+        Clock::time_point t0 = Clock::now();
+        if (incremental) {
+            step = renderer.clearIncremental(earth);
+        } else {
+            renderer.clearBuffers();
+        }
+        Clock::time_point t1 = Clock::now();
+        if (incremental) {
+            renderer.renderIncrementalStars(step);
+        } else {
+            renderer.renderStars();
+        }
+        Clock::time_point t2 = Clock::now();
+        if (incremental) {
+            renderer.renderIncrementalSurface(earth, step);
+        } else {
+            renderer.renderSurface(earth);
+        }
+        Clock::time_point t3 = Clock::now();
+        const std::string& encoded = renderer.encodeFrame();
+        Clock::time_point t4 = Clock::now();
+
+        earth.rotationY += 0.03;
+        if (earth.rotationY >= 2.0 * PI) earth.rotationY -= 2.0 * PI;
+        if (frame < config.warmup) continue;
+
+        samples[0].push_back(micros(t0, t1));
+        samples[1].push_back(micros(t1, t2));
+        samples[2].push_back(micros(t2, t3));
+        samples[3].push_back(micros(t3, t4));
+        samples[4].push_back(micros(t0, t4));
+        bytes.push_back(static_cast<double>(encoded.size()));
+    }
+
+    BenchResult result;
+    result.width = width;
+    result.height = height;
+    result.mode = mode;
+    result.threads = renderer.getThreadCount();
+    result.frames = config.frames;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        result.stages[stage] = summarize(samples[stage]);
+    }
+    result.bytes = summarize(bytes);
+    result.renderWidth = renderer.getFrame().width;
+    result.renderHeight = renderer.getFrame().height;
+    double medianTotal = result.stages[STAGE_COUNT - 1].median;
+    double framesPerSecond = medianTotal > 0 ? 1e6 / medianTotal : 0.0;
+    result.pixelsPerSecond = result.renderWidth * result.renderHeight * framesPerSecond;
+    result.outputPixelsPerSecond = width * height * framesPerSecond;
+    return result;
+}
+
+struct SceneResult {
+    int bodies;
+    long rays;
+    double bvhRaysPerSecond;
+    double linearRaysPerSecond;
+    double refitMicros;  // median per frame
+};
+
+static SceneResult runSceneBenchmark(int bodies, int width, int height, const BenchConfig& config) {
+    Scene scene;
+    scene.addBody(Earth(3.0, Vec3(0, 0, 0)));
+    addDebrisField(scene, bodies - 1, 3.5, 5.5);
+    Camera camera(Vec3(0, 2, -9), Vec3(0, 0, 0), Vec3(0, 1, 0), 45.0, static_cast<double>(width) / height * 0.5);
+
+    typedef std::chrono::steady_clock Clock;
+    auto seconds = [](Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double>(to - from).count();
+    };
+    // The linear pass gets slow fast, cap how many frames it has to do
+    int frames = std::max(1, std::min(config.frames, 2000000 / (width * height * bodies) + 1));
+
+    double bvhSeconds = 0.0, linearSeconds = 0.0;
+    long hits = 0;
+    std::vector<double> refits;
+    for (int frame = 0; frame < frames; frame++) {
+        Clock::time_point t0 = Clock::now();
+        scene.animate(frame * 0.03);
+        Clock::time_point t1 = Clock::now();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                Scene::Hit hit;
+                hits += scene.intersect(camera.position, camera.rayDirection(2.0 * x / width - 1.0, 1.0 - 2.0 * y / height), hit);
+            }
+        }
+        Clock::time_point t2 = Clock::now();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                Scene::Hit hit;
+                hits -= scene.intersectLinear(camera.position, camera.rayDirection(2.0 * x / width - 1.0, 1.0 - 2.0 * y / height), hit);
+            }
+        }
+        Clock::time_point t3 = Clock::now();
+        refits.push_back(seconds(t0, t1) * 1e6);
+        bvhSeconds += seconds(t1, t2);
+        linearSeconds += seconds(t2, t3);
+    }
+    if (hits != 0) std::fprintf(stderr, "bvh and linear hit counts differ by %ld\n", hits);
+
+    SceneResult result;
+    result.bodies = bodies;
+    result.rays = static_cast<long>(width) * height * frames;
+    result.bvhRaysPerSecond = bvhSeconds > 0 ? result.rays / bvhSeconds : 0.0;
+    result.linearRaysPerSecond = linearSeconds > 0 ? result.rays / linearSeconds : 0.0;
+    result.refitMicros = summarize(refits).median;
+    return result;
+}
+
+static void printSceneResults(const std::vector<SceneResult>& results, const std::string& format) {
+    if (format == "csv") {
+        std::printf("bodies,rays,bvh_rays_per_second,linear_rays_per_second,update_us\n");
+        for (const SceneResult& r : results) {
+            std::printf("%d,%ld,%.0f,%.0f,%.2f\n", r.bodies, r.rays, r.bvhRaysPerSecond, r.linearRaysPerSecond,
+                        r.refitMicros);
+        }
+        return;
+    }
+    std::printf("[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const SceneResult& r = results[i];
+        std::printf("  {\"bodies\": %d, \"rays\": %ld, \"bvh_rays_per_second\": %.0f, "
+                    "\"linear_rays_per_second\": %.0f, \"update_us\": %.2f}%s\n",
+                    r.bodies, r.rays, r.bvhRaysPerSecond, r.linearRaysPerSecond, r.refitMicros,
+                    i + 1 < results.size() ? "," : "");
+    }
+    std::printf("]\n");
+}
+
+static void printJson(const std::vector<BenchResult>& results) {
+    std::printf("[\n");
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchResult& result = results[r];
+        std::printf("  {\"width\": %d, \"height\": %d, \"mode\": \"%s\", \"threads\": %d, \"frames\": %d,\n",
+                    result.width, result.height, result.mode.c_str(), result.threads, result.frames);
+        std::printf("   \"stages_us\": {");
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            const Stats& s = result.stages[stage];
+            std::printf("%s\"%s\": {\"min\": %.2f, \"median\": %.2f, \"p99\": %.2f}",
+                        stage ? ", " : "", STAGES[stage], s.min, s.median, s.p99);
+        }
+        std::printf("},\n");
+        std::printf("   \"render_width\": %d, \"render_height\": %d,\n", result.renderWidth, result.renderHeight);
+        std::printf("   \"pixels_per_second\": %.0f, \"output_pixels_per_second\": %.0f,\n", result.pixelsPerSecond,
+                    result.outputPixelsPerSecond);
+        std::printf("   \"bytes_per_frame\": {\"min\": %.0f, \"median\": %.0f, \"p99\": %.0f, \"mean\": %.1f}}%s\n",
+                    result.bytes.min, result.bytes.median, result.bytes.p99, result.bytes.mean,
+                    r + 1 < results.size() ? "," : "");
+    }
+    std::printf("]\n");
+}
+
+static void printCsv(const std::vector<BenchResult>& results) {
+    std::printf("width,height,render_width,render_height,mode,threads,frames,stage,min_us,median_us,p99_us,"
+                "pixels_per_second,output_pixels_per_second,mean_bytes_per_frame\n");
+    for (const BenchResult& result : results) {
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            const Stats& s = result.stages[stage];
+            std::printf("%d,%d,%d,%d,%s,%d,%d,%s,%.2f,%.2f,%.2f,%.0f,%.0f,%.1f\n",
+                        result.width, result.height, result.renderWidth, result.renderHeight, result.mode.c_str(),
+                        result.threads, result.frames, STAGES[stage], s.min, s.median, s.p99, result.pixelsPerSecond,
+                        result.outputPixelsPerSecond, result.bytes.mean);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            config.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            config.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            config.threads = std::atoi(argv[++i]);
+        } else if (arg == "--format" && i + 1 < argc) {
+            config.format = argv[++i];
+            if (config.format != "json" && config.format != "csv") {
+                std::fprintf(stderr, "unknown format %s\n", config.format.c_str());
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--modes" && i + 1 < argc) {
+            config.modes = split(argv[++i], ',');
+            for (const std::string& mode : config.modes) {
+                std::string unknown = unknownModeOption(mode);
+                if (!unknown.empty()) {
+                    std::fprintf(stderr, "unknown mode option '%s' in %s\n", unknown.c_str(), mode.c_str());
+                    printUsage();
+                    return 1;
+                }
+            }
+        } else if (arg == "--bodies" && i + 1 < argc) {
+            for (const std::string& count : split(argv[++i], ',')) config.bodies.push_back(std::max(1, std::atoi(count.c_str())));
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            config.sizes.clear();
+            for (const std::string& size : split(argv[++i], ',')) {
+                int w = 0, h = 0;
+                if (std::sscanf(size.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0) config.sizes.push_back({w, h});
+            }
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (!config.bodies.empty()) {
+        if (config.sizes.empty()) {
+            std::fprintf(stderr, "no valid --sizes\n");
+            return 1;
+        }
+        std::vector<SceneResult> results;
+        for (int bodies : config.bodies) {
+            results.push_back(runSceneBenchmark(bodies, config.sizes[0].first, config.sizes[0].second, config));
+        }
+        printSceneResults(results, config.format);
+        return 0;
+    }
+
+    std::vector<BenchResult> results;
+    for (const auto& size : config.sizes) {
+        for (const std::string& mode : config.modes) {
+            results.push_back(runBenchmark(size.first, size.second, mode, config));
+        }
+    }
+
+    if (config.format == "csv") {
+        printCsv(results);
+    } else {
+        printJson(results);
+    }
+    return 0;
+}
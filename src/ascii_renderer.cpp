@@ -0,0 +1,754 @@
+#include "ascii_renderer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "random.h"
+
+std::string ASCIIRenderer::makeBanner(int width, bool useColor) {
+    std::string padding(std::max(0, (width - 58) / 2), ' ');
+    std::string banner;
+    if (useColor) banner += Color::BRIGHT_CYAN;
+    banner += padding + " _   _      _ _                            _     _ _ \n";
+    banner += padding + "| | | | ___| | | ___   __      _____  _ __| | __| | |\n";
+    banner += padding + "| |_| |/ _ \\ | |/ _ \\  \\ \\ /\\ / / _ \\| '__| |/ _` | |\n";
+    banner += padding + "|  _  |  __/ | | (_) |  \\ V  V / (_) | |  | | (_| |_|\n";
+    banner += padding + "|_| |_|\\___|_|_|\\___/    \\_/\\_/ \\___/|_|  |_|\\__,_(_)\n";
+    if (useColor) banner += Color::RESET;
+    banner += '\n';
+    return banner;
+}
+
+void ASCIIRenderer::renderStars() {
+    ProfileScope scope(profiler, ProfileStage::Stars);
+    stars.draw(frame, frameIndex);
+}
+
+void ASCIIRenderer::resize(int w, int h) {
+    outputWidth = std::max(1, w);
+    outputHeight = std::max(1, h);
+    // The geometry cache is keyed on the size and aspect, no need to throw it away
+    camera.aspectRatio = static_cast<double>(outputWidth) / outputHeight * 0.4;
+    applyScale(renderScale);
+}
+
+void ASCIIRenderer::applyScale(double scale) {
+    renderScale = std::max(0.1, std::min(1.0, scale));
+    int w = std::max(1, static_cast<int>(std::lround(outputWidth * renderScale)));
+    int h = std::max(1, static_cast<int>(std::lround(outputHeight * renderScale)));
+    if (w == width && h == height) return;
+    width = w;
+    height = h;
+    frame.resize(w, h);
+    resizeGeometric(surfaceClass, frame.glyphs.size());
+    std::fill(surfaceClass.begin(), surfaceClass.end(), 0);
+    active = frame.fullRect();
+}
+
+void ASCIIRenderer::adaptResolution(double micros) {
+    if (resolutionBudget <= 0.0) return;
+    renderTime = framesAtScale == 0 ? micros : 0.8 * renderTime + 0.2 * micros;
+    // Give a new size a few frames to settle (caches, starfield) before judging it
+    if (++framesAtScale < 8) return;
+
+    // Render time goes with the cell count, i.e. the square of the scale
+    double target = renderScale;
+    if (renderTime > resolutionBudget) {
+        target = renderScale * std::sqrt(resolutionBudget / renderTime) * 0.95;
+    } else if (renderTime < resolutionBudget * 0.5) {
+        target = renderScale * 1.15;
+    }
+    target = std::max(minRenderScale, std::min(1.0, target));
+    if (std::fabs(target - renderScale) < 0.02) return;
+    pendingScale = target;
+    framesAtScale = 0;
+}
+
+void ASCIIRenderer::render(const Earth& earth) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    if (pendingScale > 0.0) {
+        applyScale(pendingScale);
+        pendingScale = 0.0;
+    }
+    if (incremental) {
+        renderIncremental(earth);
+    } else {
+        clearBuffers();
+        renderStars();
+        renderSurface(earth);
+    }
+    adaptResolution(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+}
+
+void ASCIIRenderer::render(const Scene& scene) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    if (pendingScale > 0.0) {
+        applyScale(pendingScale);
+        pendingScale = 0.0;
+    }
+    clearBuffers();
+    renderStars();
+    renderSurface(scene);
+    adaptResolution(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+}
+
+CellRect ASCIIRenderer::globeFootprint(const Earth& earth) const {
+    double minX, maxX, minY, maxY;
+    if (!camera.projectSphere(earth.position, earth.radius, minX, maxX, minY, maxY)) return frame.fullRect();
+
+    // Cell x is ray-cast at screenX = 2x / width - 1 and y at 1 - 2y / height. The spare cell
+    // covers rounding and the antialiasing rays, which land anywhere inside a cell.
+    auto clampScreen = [](double v) { return std::max(-2.0, std::min(2.0, v)); };
+    CellRect rect;
+    rect.x0 = static_cast<int>(std::floor((clampScreen(minX) + 1.0) * 0.5 * width)) - 1;
+    rect.x1 = static_cast<int>(std::ceil((clampScreen(maxX) + 1.0) * 0.5 * width)) + 2;
+    rect.y0 = static_cast<int>(std::floor((1.0 - clampScreen(maxY)) * 0.5 * height)) - 1;
+    rect.y1 = static_cast<int>(std::ceil((1.0 - clampScreen(minY)) * 0.5 * height)) + 2;
+    rect.x0 = std::max(0, rect.x0);
+    rect.y0 = std::max(0, rect.y0);
+    rect.x1 = std::min(width, rect.x1);
+    rect.y1 = std::min(height, rect.y1);
+    if (rect.empty()) rect.x0 = rect.y0 = rect.x1 = rect.y1 = 0;
+    return rect;
+}
+
+void ASCIIRenderer::renderIncremental(const Earth& earth) {
+    IncrementalStep step = clearIncremental(earth);
+    renderIncrementalStars(step);
+    renderIncrementalSurface(earth, step);
+}
+
+ASCIIRenderer::IncrementalStep ASCIIRenderer::clearIncremental(const Earth& earth) {
+    IncrementalStep step;
+    step.rect = globeFootprint(earth);
+
+    // Everything outside the footprint is stars, so the key is whatever decides where they go.
+    // Twinkling stars change every frame, those frames redraw the whole background.
+    step.key = 0;
+    if (!stars.getTwinkle()) {
+        step.key = splitMix64(stars.getSeed());
+        const int parts[] = {width, height, step.rect.x0, step.rect.y0, step.rect.x1, step.rect.y1};
+        for (int part : parts) step.key = splitMix64(step.key ^ static_cast<uint32_t>(part));
+        step.key |= 1;
+    }
+
+    // Fresh buffer (or one from before the footprint moved), needs the background once
+    step.fresh = step.key == 0 || frame.backgroundKey != step.key;
+    if (step.fresh) {
+        clearBuffers();
+    } else {
+        ProfileScope scope(profiler, ProfileStage::Clear);
+        frame.clear(step.rect);
+        if (antialiasing) std::fill(surfaceClass.begin(), surfaceClass.end(), 0);
+    }
+    return step;
+}
+
+void ASCIIRenderer::renderIncrementalStars(const IncrementalStep& step) {
+    if (step.fresh) {
+        renderStars();
+    } else {
+        ProfileScope scope(profiler, ProfileStage::Stars);
+        stars.draw(frame, frameIndex, step.rect);
+    }
+}
+
+void ASCIIRenderer::renderIncrementalSurface(const Earth& earth, const IncrementalStep& step) {
+    active = step.rect;
+    renderSurface(earth);
+    active = frame.fullRect();
+    frame.backgroundKey = step.key;
+    frame.dirty = step.key ? step.rect : frame.fullRect();
+}
+
+const char* renderPrecisionName(RenderPrecision precision) {
+    switch (precision) {
+        case RenderPrecision::Float: return "float";
+        case RenderPrecision::Fixed: return "fixed";
+        default: return "double";
+    }
+}
+
+template <bool Color, bool Clouds>
+void ASCIIRenderer::shadePixel(const Earth& earth, int x, int y, const Vec3& lightDir, ProfileTile& prof) {
+    int i = frame.index(x, y);
+    double screenX = 2.0 * (static_cast<double>(x) / width) - 1.0;
+    double screenY = 1.0 - 2.0 * (static_cast<double>(y) / height);
+    Vec3 rayDir = camera.rayDirection(screenX, screenY);
+    prof.mark(ProfileStage::RayGen);
+
+    double depth;
+    Vec3 hitPoint, normal;
+
+    bool hit = earth.intersectRay(camera.position, rayDir, depth, hitPoint, normal);
+    prof.mark(ProfileStage::Intersect);
+    prof.count(ProfileCounter::Rays);
+    if (hit) {
+        prof.count(ProfileCounter::Hits);
+        // Depth
+        if (depth < frame.depth[i]) {
+            // this is where we use Dot Product (:
+            double diffuse = std::max(0.0, normal.dot(lightDir));
+            double lat, lon;
+            earth.baseLatLon(hitPoint, lat, lon);
+            int level = earth.textureLevel(mipScale * surfaceFootprint(depth, normal, rayDir));
+            prof.mark(ProfileStage::Texture);
+            shadeSurface<Color, Clouds>(earth, i, lat, earth.spinLongitude(lon), level, diffuse);
+            frame.depth[i] = depth;
+            prof.mark(ProfileStage::Shade);
+        }
+    }
+}
+
+template <typename T>
+void ASCIIRenderer::prepareScalarScene(ScalarScene<T>& scene, ScalarShading<T>& shading, const Earth& earth,
+                                       const Vec3& lightDir) const {
+    Vec3 forward, right, trueUp;
+    double widthAtDist1, heightAtDist1;
+    camera.getBasis(forward, right, trueUp, widthAtDist1, heightAtDist1);
+    scene.origin = Vec3T<T>(camera.position);
+    scene.center = Vec3T<T>(earth.position);
+    scene.radius = static_cast<T>(earth.radius);
+    scene.light = Vec3T<T>(lightDir);
+    scene.forward = Vec3T<T>(forward);
+    scene.right = Vec3T<T>(right);
+    scene.up = Vec3T<T>(trueUp);
+    scene.widthAtDist1 = static_cast<T>(widthAtDist1);
+    scene.heightAtDist1 = static_cast<T>(heightAtDist1);
+
+    shading.spin = static_cast<T>(earth.spinLongitude(0.0));
+    shading.mipScale = static_cast<T>(mipScale);
+    shading.texture.resize(earth.texture.getLevelCount());
+    for (int level = 0; level < earth.texture.getLevelCount(); level++) {
+        shading.texture[level] = earth.texture.texelScale<T>(level);
+    }
+    shading.cityLights = earth.cityLights.texelScale<T>(0);
+}
+
+template <typename T, bool Color, bool Clouds>
+void ASCIIRenderer::shadeRow(const Earth& earth, int x0, int x1, int y, ProfileTile& prof) {
+    const ScalarScene<T>& scene = scalarScene(T());
+    const ScalarShading<T>& shading = scalarShading(T());
+    bool mipmapped = mipScale > 0.0;
+    // Start and step are converted once per row and the step is added in T. Rows are a tile wide,
+    // so the step's rounding adds up to well under a pixel even in fixed point.
+    T screenY = static_cast<T>(1.0 - 2.0 * (static_cast<double>(y) / height));
+    T screenX = static_cast<T>(2.0 * (static_cast<double>(x0) / width) - 1.0);
+    T stepX = static_cast<T>(2.0 / width);
+    ScalarHit<T> hit;
+    prof.count(ProfileCounter::Rays, x1 - x0);
+    for (int x = x0; x < x1; x++, screenX = screenX + stepX) {
+        int i = frame.index(x, y);
+        // Ray generation is folded into the kernel here
+        bool traced = traceScalar(scene, screenX, screenY, hit);
+        prof.mark(ProfileStage::Intersect);
+        if (!traced) continue;
+        prof.count(ProfileCounter::Hits);
+        // The depth buffer is float, so the depth test and store convert the hit's depth to
+        // float (a multiply per hit for Fixed). Everything else per pixel stays in T.
+        float depth = static_cast<float>(hit.depth);
+        if (depth >= frame.depth[i]) continue;
+        int level = mipmapped ? earth.textureLevel(texelsPerPixel(shading, hit)) : 0;
+        shadeSurface<Color, Clouds>(earth, i, hit.lat, spinLongitude(shading, hit.lon), level, hit.diffuse);
+        frame.depth[i] = depth;
+        prof.mark(ProfileStage::Shade);
+    }
+}
+
+void ASCIIRenderer::shadeSurface(const Earth& earth, int i, double lat_rad, double lon_rad, int textureLevel,
+                                 double diffuse) {
+    if (useColor) {
+        if (earth.cloudy) shadeSurface<true, true>(earth, i, lat_rad, lon_rad, textureLevel, diffuse);
+        else shadeSurface<true, false>(earth, i, lat_rad, lon_rad, textureLevel, diffuse);
+    } else {
+        if (earth.cloudy) shadeSurface<false, true>(earth, i, lat_rad, lon_rad, textureLevel, diffuse);
+        else shadeSurface<false, false>(earth, i, lat_rad, lon_rad, textureLevel, diffuse);
+    }
+}
+
+template <bool Color, bool Clouds, typename T>
+void ASCIIRenderer::shadeSurface(const Earth& earth, int i, T lat_rad, T lon_rad, int textureLevel, T diffuse) {
+    char texChar = textureChar(earth, lat_rad, lon_rad, textureLevel);
+    surfaceClass[i] = texChar == '#' ? 2 : 1;
+
+    if (Color) {
+        if (texChar == '#') {
+            using std::abs;
+            T polarFactor = abs(lat_rad / T(PI / 2.0));
+            frame.colors[i] = (polarFactor > T(0.7)) ? ColorIndex::BrightWhite : ColorIndex::BrightGreen;
+            if (diffuse > T(0.8)) frame.glyphs[i] = '%';
+            else if (diffuse > T(0.6)) frame.glyphs[i] = '&';
+            else if (diffuse > T(0.3)) frame.glyphs[i] = '$';
+            else frame.glyphs[i] = '#';
+        } else {
+            frame.colors[i] = diffuse > T(0.7) ? ColorIndex::BrightBlue : ColorIndex::Blue;
+            if (diffuse > T(0.8)) frame.glyphs[i] = '~';
+            else if (diffuse > T(0.6)) frame.glyphs[i] = '^';
+            else frame.glyphs[i] = '.';
+        }
+
+        if (Clouds && diffuse >= T(0.2)) applyClouds(i, clouds.density(lat_rad, lon_rad));
+
+        // night
+        if (diffuse < T(0.2)) {
+            if (texChar == '#') {
+                frame.colors[i] = ColorIndex::Black;
+                frame.glyphs[i] = '.';
+                if (cityLight(earth, lat_rad, lon_rad)) {
+                    frame.colors[i] = ColorIndex::BrightYellow;
+                }
+            } else {
+                frame.colors[i] = ColorIndex::Blue;
+                frame.glyphs[i] = ' ';
+            }
+        }
+    }
+    else {
+         if (texChar == '#') {
+            if (diffuse > T(0.8)) frame.glyphs[i] = '%';
+            else if (diffuse > T(0.6)) frame.glyphs[i] = '&';
+            else if (diffuse > T(0.3)) frame.glyphs[i] = '$';
+            else if (diffuse >= T(0.2)) frame.glyphs[i] = '#';
+            else frame.glyphs[i] = '.';
+        } else {
+            if (diffuse > T(0.8)) frame.glyphs[i] = '~';
+            else if (diffuse > T(0.6)) frame.glyphs[i] = '^';
+            else if (diffuse >= T(0.2)) frame.glyphs[i] = '.';
+            else frame.glyphs[i] = ' ';
+        }
+        if (Clouds && diffuse >= T(0.2)) applyClouds(i, clouds.density(lat_rad, lon_rad));
+    }
+}
+
+void ASCIIRenderer::preparePacketScene(const Earth& earth, const Vec3& lightDir) {
+    Vec3 forward, right, trueUp;
+    double widthAtDist1, heightAtDist1;
+    camera.getBasis(forward, right, trueUp, widthAtDist1, heightAtDist1);
+    const Vec3* sources[] = {&camera.position, &earth.position, &lightDir, &forward, &right, &trueUp};
+    float* targets[] = {packetScene.origin, packetScene.center, packetScene.light,
+                        packetScene.forward, packetScene.right, packetScene.up};
+    for (int v = 0; v < 6; v++) {
+        targets[v][0] = static_cast<float>(sources[v]->x);
+        targets[v][1] = static_cast<float>(sources[v]->y);
+        targets[v][2] = static_cast<float>(sources[v]->z);
+    }
+    packetScene.radius = static_cast<float>(earth.radius);
+    packetScene.widthAtDist1 = static_cast<float>(widthAtDist1);
+    packetScene.heightAtDist1 = static_cast<float>(heightAtDist1);
+}
+
+template <bool Color, bool Clouds>
+void ASCIIRenderer::shadeRowPacket(const Earth& earth, int x0, int x1, int y, ProfileTile& prof) {
+    alignas(32) float screenX[PACKET_SIZE];
+    alignas(32) float screenY[PACKET_SIZE];
+    HitPacket hits;
+    float rowY = static_cast<float>(1.0 - 2.0 * (static_cast<double>(y) / height));
+
+    for (int start = x0; start < x1; start += packetSize) {
+        int lanes = std::min(packetSize, x1 - start);
+        for (int lane = 0; lane < packetSize; lane++) {
+            // Pad the tail by repeating the last pixel, those lanes get ignored
+            int x = start + std::min(lane, lanes - 1);
+            screenX[lane] = static_cast<float>(2.0 * (static_cast<double>(x) / width) - 1.0);
+            screenY[lane] = rowY;
+        }
+        prof.mark(ProfileStage::RayGen);
+        packetKernel(packetScene, screenX, screenY, packetSize, hits);
+        prof.mark(ProfileStage::Intersect);
+        prof.count(ProfileCounter::Rays, lanes);
+
+        for (int lane = 0; lane < lanes; lane++) {
+            int x = start + lane;
+            int i = frame.index(x, y);
+            if (!hits.hit[lane]) continue;
+            prof.count(ProfileCounter::Hits);
+            if (hits.depth[lane] >= frame.depth[i]) continue;
+            Vec3 hitPoint(hits.pointX[lane], hits.pointY[lane], hits.pointZ[lane]);
+            Vec3 normal(hits.normalX[lane], hits.normalY[lane], hits.normalZ[lane]);
+            double lat, lon;
+            earth.baseLatLon(hitPoint, lat, lon);
+            int level = 0;
+            if (mipScale > 0.0) {
+                Vec3 rayDir = (hitPoint - camera.position) * (1.0 / hits.depth[lane]);
+                level = earth.textureLevel(mipScale * surfaceFootprint(hits.depth[lane], normal, rayDir));
+            }
+            prof.mark(ProfileStage::Texture);
+            shadeSurface<Color, Clouds>(earth, i, lat, earth.spinLongitude(lon), level,
+                                        static_cast<double>(hits.diffuse[lane]));
+            frame.depth[i] = hits.depth[lane];
+            prof.mark(ProfileStage::Shade);
+        }
+    }
+}
+
+void ASCIIRenderer::buildCacheTile(const Earth& earth, int tile) {
+    int tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    int x0 = (tile % tilesX) * TILE_WIDTH;
+    int y0 = (tile / tilesX) * TILE_HEIGHT;
+    int x1 = std::min(width, x0 + TILE_WIDTH);
+    int y1 = std::min(height, y0 + TILE_HEIGHT);
+    std::vector<GeometryCache::Hit>& hits = geometryCache.tiles[tile];
+    hits.clear();
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            double screenX = 2.0 * (static_cast<double>(x) / width) - 1.0;
+            double screenY = 1.0 - 2.0 * (static_cast<double>(y) / height);
+            Vec3 rayDir = camera.rayDirection(screenX, screenY);
+            GeometryCache::Hit hit;
+            if (earth.intersectRay(camera.position, rayDir, hit.depth, hit.hitPoint, hit.normal)) {
+                hit.index = frame.index(x, y);
+                earth.baseLatLon(hit.hitPoint, hit.lat, hit.lon);
+                hit.footprint = surfaceFootprint(hit.depth, hit.normal, rayDir);
+                hits.push_back(hit);
+            }
+        }
+    }
+}
+
+void ASCIIRenderer::updateGeometryCache(const Earth& earth, int tileCount) {
+    GeometryCache::Key key = GeometryCache::makeKey(camera, earth, width, height);
+    if (geometryCache.valid && geometryCache.key == key) return;
+
+    geometryCache.tiles.resize(tileCount);
+    if (pool) {
+        pool->parallelFor(tileCount, [&](int tile) {
+            buildCacheTile(earth, tile);
+        });
+    } else {
+        for (int tile = 0; tile < tileCount; tile++) {
+            buildCacheTile(earth, tile);
+        }
+    }
+    geometryCache.key = key;
+    geometryCache.valid = true;
+}
+
+template <typename T, bool Color, bool Clouds>
+void ASCIIRenderer::renderTile(const Earth& earth, int tile, const Vec3& lightDir) {
+    // A cached hit is a "row" and costs next to nothing, so sample those more sparsely
+    ProfileTile prof(profiler, geometryCaching ? 64 : 8);
+    if (geometryCaching) {
+        // No rays at all, just texture and shading for the cached hits
+        for (const GeometryCache::Hit& hit : geometryCache.tiles[tile]) {
+            prof.beginRow();
+            if (hit.depth < frame.depth[hit.index]) {
+                double diffuse = std::max(0.0, hit.normal.dot(lightDir));
+                double lon = earth.spinLongitude(hit.lon);
+                int level = earth.textureLevel(mipScale * hit.footprint);
+                prof.mark(ProfileStage::Texture);
+                shadeSurface<Color, Clouds>(earth, hit.index, hit.lat, lon, level, diffuse);
+                frame.depth[hit.index] = hit.depth;
+                prof.mark(ProfileStage::Shade);
+            }
+        }
+        return;
+    }
+
+    int tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    int x0 = std::max(active.x0, (tile % tilesX) * TILE_WIDTH);
+    int y0 = std::max(active.y0, (tile / tilesX) * TILE_HEIGHT);
+    int x1 = std::min(active.x1, (tile % tilesX) * TILE_WIDTH + TILE_WIDTH);
+    int y1 = std::min(active.y1, (tile / tilesX) * TILE_HEIGHT + TILE_HEIGHT);
+    if (packetTracing) {
+        for (int y = y0; y < y1; y++) {
+            prof.beginRow();
+            shadeRowPacket<Color, Clouds>(earth, x0, x1, y, prof);
+        }
+        return;
+    }
+    CellRect rect = {x0, y0, x1, y1};
+    renderRows<Color, Clouds>(earth, rect, lightDir, prof, T());
+}
+
+template <bool Color, bool Clouds>
+void ASCIIRenderer::renderRows(const Earth& earth, const CellRect& rect, const Vec3& lightDir, ProfileTile& prof,
+                               double) {
+    for (int y = rect.y0; y < rect.y1; y++) {
+        prof.beginRow();
+        for (int x = rect.x0; x < rect.x1; x++) {
+            shadePixel<Color, Clouds>(earth, x, y, lightDir, prof);
+        }
+    }
+}
+
+template <bool Color, bool Clouds, typename T>
+void ASCIIRenderer::renderRows(const Earth& earth, const CellRect& rect, const Vec3&, ProfileTile& prof, T) {
+    for (int y = rect.y0; y < rect.y1; y++) {
+        prof.beginRow();
+        shadeRow<T, Color, Clouds>(earth, rect.x0, rect.x1, y, prof);
+    }
+}
+
+ASCIIRenderer::TileRenderer ASCIIRenderer::pickTileRenderer(bool clouds) const {
+    static const TileRenderer renderers[3][2][2] = {
+        {{&ASCIIRenderer::renderTile<double, false, false>, &ASCIIRenderer::renderTile<double, false, true>},
+         {&ASCIIRenderer::renderTile<double, true, false>, &ASCIIRenderer::renderTile<double, true, true>}},
+        {{&ASCIIRenderer::renderTile<float, false, false>, &ASCIIRenderer::renderTile<float, false, true>},
+         {&ASCIIRenderer::renderTile<float, true, false>, &ASCIIRenderer::renderTile<float, true, true>}},
+        {{&ASCIIRenderer::renderTile<Fixed, false, false>, &ASCIIRenderer::renderTile<Fixed, false, true>},
+         {&ASCIIRenderer::renderTile<Fixed, true, false>, &ASCIIRenderer::renderTile<Fixed, true, true>}},
+    };
+    return renderers[static_cast<int>(precision)][useColor ? 1 : 0][clouds ? 1 : 0];
+}
+
+void ASCIIRenderer::renderSurface(const Earth& earth) {
+    Vec3 lightDir = earth.sunDirection();
+    clouds.update(earth.rotationY * 0.7);
+
+    if (packetTracing) preparePacketScene(earth, lightDir);
+    // Angle one character cell covers, turned into texels per unit of footprint
+    mipScale = textureMipmapping ? pixelAngle() / earth.radius * earth.texture.getLatRes() / PI : 0.0;
+
+    if (precision == RenderPrecision::Float) prepareScalarScene(floatScene, floatShading, earth, lightDir);
+    if (precision == RenderPrecision::Fixed) prepareScalarScene(fixedScene, fixedShading, earth, lightDir);
+    TileRenderer tileRenderer = pickTileRenderer(earth.cloudy);
+
+    // Pixel Iteration, tile by tile
+    int tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    int tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    int tileCount = tilesX * tilesY;
+    if (geometryCaching) updateGeometryCache(earth, tileCount);
+
+    // Only the tiles that overlap the active cells (all of them unless incremental)
+    int firstX = active.x0 / TILE_WIDTH;
+    int firstY = active.y0 / TILE_HEIGHT;
+    int spanX = active.empty() ? 0 : (active.x1 - 1) / TILE_WIDTH - firstX + 1;
+    int spanY = active.empty() ? 0 : (active.y1 - 1) / TILE_HEIGHT - firstY + 1;
+    auto renderJob = [&](int job) {
+        int tile = (firstY + job / spanX) * tilesX + firstX + job % spanX;
+        (this->*tileRenderer)(earth, tile, lightDir);
+    };
+    if (pool) {
+        pool->parallelFor(spanX * spanY, renderJob);
+    } else {
+        for (int job = 0; job < spanX * spanY; job++) renderJob(job);
+    }
+    if (antialiasing) antialias(earth, lightDir);
+    frameIndex++;
+    if (profiler.isEnabled()) profiler.add(ProfileCounter::Frames);
+}
+
+double ASCIIRenderer::pixelAngle() const {
+    Vec3 forward, right, trueUp;
+    double widthAtDist1, heightAtDist1;
+    camera.getBasis(forward, right, trueUp, widthAtDist1, heightAtDist1);
+    return std::max(widthAtDist1 / width, heightAtDist1 / height);
+}
+
+void ASCIIRenderer::renderSurface(const Scene& scene) {
+    if (scene.getBodyCount() == 0) return;
+    Vec3 lightDir = scene.lightDirection();
+    clouds.update(scene.getBody(0).rotationY * 0.7);
+    double angle = textureMipmapping ? pixelAngle() : 0.0;
+
+    int tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    int tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    int tileCount = tilesX * tilesY;
+    auto renderTile = [&](int tile) {
+        int x0 = (tile % tilesX) * TILE_WIDTH;
+        int y0 = (tile / tilesX) * TILE_HEIGHT;
+        int x1 = std::min(width, x0 + TILE_WIDTH);
+        int y1 = std::min(height, y0 + TILE_HEIGHT);
+        ProfileTile prof(profiler);
+        for (int y = y0; y < y1; y++) {
+            prof.beginRow();
+            for (int x = x0; x < x1; x++) {
+                shadeScenePixel(scene, x, y, lightDir, angle, prof);
+            }
+        }
+    };
+    if (pool) {
+        pool->parallelFor(tileCount, renderTile);
+    } else {
+        for (int tile = 0; tile < tileCount; tile++) renderTile(tile);
+    }
+    frameIndex++;
+    if (profiler.isEnabled()) profiler.add(ProfileCounter::Frames);
+}
+
+void ASCIIRenderer::shadeScenePixel(const Scene& scene, int x, int y, const Vec3& lightDir, double angle,
+                                    ProfileTile& prof) {
+    int i = frame.index(x, y);
+    double screenX = 2.0 * (static_cast<double>(x) / width) - 1.0;
+    double screenY = 1.0 - 2.0 * (static_cast<double>(y) / height);
+    Vec3 rayDir = camera.rayDirection(screenX, screenY);
+    prof.mark(ProfileStage::RayGen);
+
+    // One closest-hit query instead of a depth test per body
+    Scene::Hit hit;
+    bool found = scene.intersect(camera.position, rayDir, hit);
+    prof.mark(ProfileStage::Intersect);
+    prof.count(ProfileCounter::Rays);
+    if (!found) return;
+    prof.count(ProfileCounter::Hits);
+    if (hit.depth >= frame.depth[i]) return;
+    const Earth& body = scene.getBody(hit.body);
+    double diffuse = std::max(0.0, hit.normal.dot(lightDir));
+    double lat, lon;
+    body.baseLatLon(hit.point, lat, lon);
+    double texelsPerPixel = angle / body.radius * body.texture.getLatRes() / PI;
+    int level = body.textureLevel(texelsPerPixel * surfaceFootprint(hit.depth, hit.normal, rayDir));
+    prof.mark(ProfileStage::Texture);
+    shadeSurface(body, i, lat, body.spinLongitude(lon), level, diffuse);
+    frame.depth[i] = hit.depth;
+    prof.mark(ProfileStage::Shade);
+}
+
+void ASCIIRenderer::antialias(const Earth& earth, const Vec3& lightDir) {
+    ProfileScope scope(profiler, ProfileStage::Antialias);
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+
+    // Limb cells go first so they're the last thing a tight budget gives up
+    aaCells.clear();
+    aaCoastCells.clear();
+    for (int y = active.y0; y < active.y1; y++) {
+        for (int x = active.x0; x < active.x1; x++) {
+            int i = frame.index(x, y);
+            uint8_t here = surfaceClass[i];
+            bool limb = false, edge = false;
+            const int neighbours[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+            for (const auto& offset : neighbours) {
+                int nx = x + offset[0], ny = y + offset[1];
+                if (nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
+                uint8_t there = surfaceClass[frame.index(nx, ny)];
+                if (there == here) continue;
+                edge = true;
+                if (here == 0 || there == 0) limb = true;
+            }
+            if (limb) {
+                aaCells.push_back(i);
+            } else if (edge) {
+                aaCoastCells.push_back(i);
+            }
+        }
+    }
+    aaCells.insert(aaCells.end(), aaCoastCells.begin(), aaCoastCells.end());
+
+    aaStats.edgeCells = static_cast<int>(aaCells.size());
+    aaStats.refinedCells = 0;
+    aaStats.rays = 0;
+    aaStats.overBudget = false;
+    aaStats.samplesPerAxis = aaSamples;
+    if (aaCells.empty()) return;
+
+    // Ray budget: thin out the sub-cell grid before dropping cells
+    size_t cellCount = aaCells.size();
+    int samples = aaSamples;
+    if (aaRayBudget > 0) {
+        while (samples > 2 && static_cast<long>(cellCount) * samples * samples > aaRayBudget) samples--;
+        cellCount = std::min(cellCount, static_cast<size_t>(aaRayBudget / (samples * samples)));
+        if (cellCount < aaCells.size()) aaStats.overBudget = true;
+    }
+    aaStats.samplesPerAxis = samples;
+    if (samples < aaSamples) aaStats.overBudget = true;
+
+    // Chunks so the time budget gets checked every so often without a clock read per cell
+    const int CHUNK = 32;
+    int chunkCount = static_cast<int>((cellCount + CHUNK - 1) / CHUNK);
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                             std::chrono::duration<double, std::micro>(aaTimeBudget));
+    std::atomic<int> refined(0);
+    std::atomic<bool> outOfTime(false);
+    auto refineChunk = [&](int chunk) {
+        if (aaTimeBudget > 0.0 && (outOfTime.load(std::memory_order_relaxed) || Clock::now() > deadline)) {
+            outOfTime.store(true, std::memory_order_relaxed);
+            return;
+        }
+        size_t end = std::min(cellCount, static_cast<size_t>(chunk + 1) * CHUNK);
+        for (size_t c = static_cast<size_t>(chunk) * CHUNK; c < end; c++) {
+            refineCell(earth, aaCells[c], samples, lightDir);
+        }
+        refined.fetch_add(static_cast<int>(end - static_cast<size_t>(chunk) * CHUNK), std::memory_order_relaxed);
+    };
+    if (pool) {
+        pool->parallelFor(chunkCount, refineChunk);
+    } else {
+        for (int chunk = 0; chunk < chunkCount; chunk++) refineChunk(chunk);
+    }
+
+    // Cells that were mostly space got blanked, put back any stars they hide. The other space
+    // cells already have theirs and get the same ones again.
+    CellRect blanked = {width, height, 0, 0};
+    for (size_t c = 0; c < cellCount; c++) {
+        int i = aaCells[c];
+        if (surfaceClass[i] != 0) continue;
+        int x = i % width, y = i / width;
+        blanked.x0 = std::min(blanked.x0, x);
+        blanked.y0 = std::min(blanked.y0, y);
+        blanked.x1 = std::max(blanked.x1, x + 1);
+        blanked.y1 = std::max(blanked.y1, y + 1);
+    }
+    if (!blanked.empty()) stars.draw(frame, frameIndex, blanked);
+
+    aaStats.refinedCells = refined.load();
+    aaStats.rays = static_cast<long>(aaStats.refinedCells) * samples * samples;
+    if (aaStats.refinedCells < aaStats.edgeCells) aaStats.overBudget = true;
+}
+
+void ASCIIRenderer::refineCell(const Earth& earth, int i, int samples, const Vec3& lightDir) {
+    int x = i % width, y = i / width;
+    int hits = 0, landHits = 0;
+    double diffuseSum = 0.0;
+    double nearestDepth = std::numeric_limits<double>::max();
+    // Sample nearest the cell's own ray, per class, for the texture and cloud lookups
+    double bestDistance[3] = {1e9, 1e9, 1e9};
+    double bestLat[3] = {0, 0, 0}, bestLon[3] = {0, 0, 0};
+    int bestLevel[3] = {0, 0, 0};
+
+    for (int sy = 0; sy < samples; sy++) {
+        for (int sx = 0; sx < samples; sx++) {
+            // Sub-cell grid centred on where the single ray went (the cell's corner)
+            double ox = (sx + 0.5) / samples - 0.5;
+            double oy = (sy + 0.5) / samples - 0.5;
+            double screenX = 2.0 * ((x + ox) / width) - 1.0;
+            double screenY = 1.0 - 2.0 * ((y + oy) / height);
+            Vec3 rayDir = camera.rayDirection(screenX, screenY);
+            double depth;
+            Vec3 hitPoint, normal;
+            if (!earth.intersectRay(camera.position, rayDir, depth, hitPoint, normal)) continue;
+
+            double lat, lon;
+            earth.baseLatLon(hitPoint, lat, lon);
+            lon = earth.spinLongitude(lon);
+            int level = earth.textureLevel(mipScale * surfaceFootprint(depth, normal, rayDir) / samples);
+            int cls = earth.getTextureCharLatLon(lat, lon, level) == '#' ? 2 : 1;
+            hits++;
+            if (cls == 2) landHits++;
+            diffuseSum += std::max(0.0, normal.dot(lightDir));
+            nearestDepth = std::min(nearestDepth, depth);
+            double distance = ox * ox + oy * oy;
+            if (distance < bestDistance[cls]) {
+                bestDistance[cls] = distance;
+                bestLat[cls] = lat;
+                bestLon[cls] = lon;
+                bestLevel[cls] = level;
+            }
+        }
+    }
+
+    double coverage = static_cast<double>(hits) / (samples * samples);
+    if (coverage < 0.25) {
+        // Mostly space after all
+        if (surfaceClass[i] != 0) {
+            frame.glyphs[i] = ' ';
+            frame.colors[i] = ColorIndex::Reset;
+            frame.depth[i] = std::numeric_limits<float>::max();
+            surfaceClass[i] = 0;
+        }
+        return;
+    }
+
+    // Whichever of land and ocean covers more of the cell wins
+    int cls = landHits * 2 >= hits ? 2 : 1;
+    shadeSurface(earth, i, bestLat[cls], bestLon[cls], bestLevel[cls], diffuseSum / hits);
+    frame.depth[i] = static_cast<float>(nearestDepth);
+
+    // Partly covered limb cells get lighter glyphs, the color still says what's there
+    if (coverage < 0.75 && frame.glyphs[i] != ' ') frame.glyphs[i] = coverage < 0.5 ? '.' : ':';
+}
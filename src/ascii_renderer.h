@@ -0,0 +1,540 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "camera.h"
+#include "cloud_layer.h"
+#include "earth.h"
+#include "fixed_point.h"
+#include "frame_buffer.h"
+#include "frame_encoder.h"
+#include "geometry_cache.h"
+#include "packet_kernel.h"
+#include "profiler.h"
+#include "scalar_kernel.h"
+#include "scene.h"
+#include "starfield.h"
+#include "thread_pool.h"
+
+// Scalar type of the per-ray geometry on the plain (non packet, non cached) path
+enum class RenderPrecision {
+    Double,
+    Float,
+    Fixed
+};
+
+const char* renderPrecisionName(RenderPrecision precision);
+
+// ASCIIIIIIIIII
+class ASCIIRenderer {
+private:
+    int width, height;              // what gets rendered, smaller than the output when scaled
+    int outputWidth, outputHeight;  // what gets displayed
+    FrameBuffer frame;
+    FrameBuffer scaledFrame;  // frame stretched to the output size, when they differ
+    Camera camera;
+    bool useColor;
+    std::unique_ptr<ThreadPool> pool;
+    uint32_t frameIndex;
+    FrameEncoder encoder;
+    std::string banner;
+    int bannerWidth;
+    std::string overlayLine;
+    bool packetTracing;
+    PacketIsa packetIsa;
+    PacketKernel packetKernel;
+    int packetSize;
+    PacketScene packetScene;
+    bool geometryCaching;
+    GeometryCache geometryCache;
+    bool textureMipmapping;
+    double mipScale;
+    CloudLayer clouds;
+    Starfield stars;
+    bool antialiasing;
+    int aaSamples;
+    long aaRayBudget;
+    double aaTimeBudget;
+    std::vector<uint8_t> surfaceClass;  // per cell: 0 nothing hit, 1 ocean, 2 land
+    std::vector<int> aaCells;
+    std::vector<int> aaCoastCells;
+    RenderPrecision precision;
+    bool incremental;
+    CellRect active;  // cells renderSurface ray-casts, all of them unless rendering incrementally
+    double renderScale;
+    double pendingScale;      // picked by the resolution budget, applied before the next frame
+    double resolutionBudget;  // microseconds per render, 0 for a fixed scale
+    double minRenderScale;
+    double renderTime;        // smoothed, microseconds
+    int framesAtScale;
+    Profiler profiler;
+    ScalarScene<double> doubleScene;
+    ScalarScene<float> floatScene;
+    ScalarScene<Fixed> fixedScene;
+    ScalarShading<double> doubleShading;
+    ScalarShading<float> floatShading;
+    ScalarShading<Fixed> fixedShading;
+
+    // One tile of the globe, specialized on precision and shading options so none of those
+    // are branched on per pixel. renderSurface picks one per frame.
+    typedef void (ASCIIRenderer::*TileRenderer)(const Earth& earth, int tile, const Vec3& lightDir);
+    TileRenderer pickTileRenderer(bool clouds) const;
+
+    const ScalarScene<double>& scalarScene(double) const {
+        return doubleScene;
+    }
+
+    const ScalarScene<float>& scalarScene(float) const {
+        return floatScene;
+    }
+
+    const ScalarScene<Fixed>& scalarScene(Fixed) const {
+        return fixedScene;
+    }
+
+    const ScalarShading<double>& scalarShading(double) const {
+        return doubleShading;
+    }
+
+    const ScalarShading<float>& scalarShading(float) const {
+        return floatShading;
+    }
+
+    const ScalarShading<Fixed>& scalarShading(Fixed) const {
+        return fixedShading;
+    }
+
+    // Needs mipScale for the frame already set
+    template <typename T>
+    void prepareScalarScene(ScalarScene<T>& scene, ScalarShading<T>& shading, const Earth& earth,
+                            const Vec3& lightDir) const;
+
+    // Sets the render size for the output size and scale, buffers are resized in place
+    void applyScale(double scale);
+    void adaptResolution(double micros);
+
+    bool scaled() const {
+        return width != outputWidth || height != outputHeight;
+    }
+
+    // Jobs handed to the pool are tiles of this many cells
+    static constexpr int TILE_WIDTH = 32;
+    static constexpr int TILE_HEIGHT = 8;
+
+public:
+    struct AntialiasStats {
+        int edgeCells;       // cells on the limb or a coastline
+        int refinedCells;    // of those, how many got the extra rays
+        int samplesPerAxis;  // sub-cell grid actually used this frame
+        long rays;           // extra rays cast
+        bool overBudget;     // the budget shrank the grid or left edge cells at one ray
+    };
+
+private:
+    AntialiasStats aaStats;
+
+public:
+    // Why characters gotta be so weird, aspect ratio took a while to get right.
+    ASCIIRenderer(int w, int h, bool color = true)
+        : width(w),
+          height(h),
+          outputWidth(w),
+          outputHeight(h),
+          frame(w, h),
+          camera(Vec3(0, 0, -8), Vec3(0, 0, 0), Vec3(0, 1, 0), 45.0, static_cast<double>(w) / h * 0.4),
+          useColor(color),
+          frameIndex(0),
+          bannerWidth(0),
+          packetTracing(false),
+          packetIsa(detectPacketIsa()),
+          packetKernel(getPacketKernel(packetIsa)),
+          packetSize(PACKET_SIZE),
+          geometryCaching(false),
+          textureMipmapping(false),
+          mipScale(0.0),
+          antialiasing(false),
+          aaSamples(3),
+          aaRayBudget(0),
+          aaTimeBudget(0.0),
+          surfaceClass(static_cast<size_t>(w) * h, 0),
+          precision(RenderPrecision::Double),
+          incremental(false),
+          active(frame.fullRect()),
+          renderScale(1.0),
+          pendingScale(0.0),
+          resolutionBudget(0.0),
+          minRenderScale(0.25),
+          renderTime(0.0),
+          framesAtScale(0),
+          aaStats() {
+        buildBanner();
+    }
+
+    // Hello World 0=
+    void buildBanner() {
+        banner = makeBanner(outputWidth, useColor);
+        bannerWidth = outputWidth;
+    }
+
+    // The banner printed under every frame, centered for a frame this wide
+    static std::string makeBanner(int width, bool useColor);
+
+    // New output size (a terminal resize). Buffers are resized in place and only grow, the
+    // camera's aspect follows. Between frames only, the pipelined loop calls it from the
+    // render thread.
+    void resize(int w, int h);
+
+    int getOutputWidth() const {
+        return outputWidth;
+    }
+
+    int getOutputHeight() const {
+        return outputHeight;
+    }
+
+    // Render at this fraction of the output size (0.1 to 1) and stretch the result up
+    void setRenderScale(double scale) {
+        pendingScale = 0.0;
+        applyScale(scale);
+    }
+
+    double getRenderScale() const {
+        return renderScale;
+    }
+
+    // Dynamic resolution: while renders take longer than budget microseconds the scale drops
+    // (not below minScale), once they are well under it climbs back towards 1. 0 turns it off
+    // and keeps whatever scale it got to.
+    void setResolutionBudget(double micros, double minScale = 0.25) {
+        resolutionBudget = std::max(0.0, micros);
+        minRenderScale = std::max(0.1, std::min(1.0, minScale));
+        framesAtScale = 0;
+    }
+
+    // Only send cells that changed since the last frame
+    void setDeltaOutput(bool enabled) {
+        encoder.setDeltaMode(enabled);
+    }
+
+    // Trace a packet of rays at a time with the SIMD kernel (float precision)
+    void setPacketTracing(bool enabled) {
+        packetTracing = enabled;
+    }
+
+    // Rays per packet, 4, 8 or 16 (rounded up to one of those). Narrow packets waste fewer
+    // lanes on the ends of short rows, wide ones amortize more per call.
+    void setPacketSize(int lanes) {
+        packetSize = validPacketSize(lanes);
+    }
+
+    int getPacketSize() const {
+        return packetSize;
+    }
+
+    // Override the detected instruction set, mostly for testing the fallbacks
+    void setPacketIsa(PacketIsa isa) {
+        packetIsa = isa;
+        packetKernel = getPacketKernel(isa);
+    }
+
+    PacketIsa getPacketIsa() const {
+        return packetIsa;
+    }
+
+    // Reuse rays and hits between frames while the camera and viewport stay put
+    void setGeometryCache(bool enabled) {
+        geometryCaching = enabled;
+        if (!enabled) invalidateGeometryCache();
+    }
+
+    // Sample coarser texture levels where a cell covers many texels (limb, big textures)
+    void setTextureMipmapping(bool enabled) {
+        textureMipmapping = enabled;
+    }
+
+    // Float halves the bandwidth of the per-ray state, Fixed is for cores without a usable FPU.
+    // Intersection and shading (lighting, texture and city light lookups, clouds, mip levels)
+    // both run in the chosen type. Only the plain path, packets are always float and the
+    // geometry cache, antialiasing and scene bodies always double.
+    void setPrecision(RenderPrecision p) {
+        precision = p;
+    }
+
+    RenderPrecision getPrecision() const {
+        return precision;
+    }
+
+    // Only ray-cast the globe's screen footprint and keep the background from earlier frames.
+    // Frames get tagged so delta output only compares (and sends) the cells inside the footprint.
+    void setIncremental(bool enabled) {
+        incremental = enabled;
+    }
+
+    bool getIncremental() const {
+        return incremental;
+    }
+
+    // Cells the globe can cover from where the camera is, with a cell to spare on every side.
+    // Empty if it's off screen, the whole frame if the camera is inside it.
+    CellRect globeFootprint(const Earth& earth) const;
+
+    // Extra sub-cell rays along the limb and coastlines, samples x samples per refined cell
+    void setAntialiasing(bool enabled, int samples = 3) {
+        antialiasing = enabled;
+        aaSamples = std::max(2, std::min(8, samples));
+    }
+
+    // Caps on the extra work per frame, 0 means no cap. Over the ray budget the sub-cell grid
+    // shrinks first, then cells get left out (coastlines before the limb). The time budget
+    // stops refining once it runs out.
+    void setAntialiasBudget(long maxRays, double maxMicros) {
+        aaRayBudget = std::max(0L, maxRays);
+        aaTimeBudget = std::max(0.0, maxMicros);
+    }
+
+    const AntialiasStats& getAntialiasStats() const {
+        return aaStats;
+    }
+
+    CloudLayer& getClouds() {
+        return clouds;
+    }
+
+    Starfield& getStars() {
+        return stars;
+    }
+
+    // Stage timers and counters, off until enabled (and nothing at all when compiled out)
+    Profiler& getProfiler() {
+        return profiler;
+    }
+
+    // Stats line printed under the banner, empty for none. Cut to the frame width when it's
+    // encoded, a wrapped line would throw off where the next frame parks the cursor.
+    void setOverlay(const std::string& line) {
+        overlayLine = line;
+    }
+
+    void invalidateGeometryCache() {
+        geometryCache.valid = false;
+        geometryCache.tiles.clear();
+    }
+
+    const Camera& getCamera() const {
+        return camera;
+    }
+
+    void setCamera(const Camera& cam) {
+        camera = cam;
+        invalidateGeometryCache();
+    }
+
+    size_t getLastFrameBytes() const {
+        return encoder.getLastFrameBytes();
+    }
+
+    double getAverageFrameBytes() const {
+        return encoder.getAverageFrameBytes();
+    }
+
+    size_t getLastChangedCells() const {
+        return encoder.getLastChangedCells();
+    }
+
+    // 1 renders serially on the calling thread, 0 picks one thread per hardware core
+    void setThreadCount(int threads) {
+        if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (threads <= 1) {
+            pool.reset();
+        } else if (!pool || pool->size() != threads) {
+            pool.reset(new ThreadPool(threads));
+        }
+    }
+
+    int getThreadCount() const {
+        return pool ? pool->size() : 1;
+    }
+
+    // The frame as rendered, at the render scale
+    const FrameBuffer& getFrame() const {
+        return frame;
+    }
+
+    // The frame at the output size (the rendered one unless scaled)
+    const FrameBuffer& getOutputFrame() {
+        if (!scaled()) return frame;
+        if (scaledFrame.width != outputWidth || scaledFrame.height != outputHeight) {
+            scaledFrame.resize(outputWidth, outputHeight);
+        }
+        scaledFrame.upscaleFrom(frame);
+        return scaledFrame;
+    }
+
+    void clearBuffers() {
+        ProfileScope scope(profiler, ProfileStage::Clear);
+        frame.clear();
+        if (antialiasing) std::fill(surfaceClass.begin(), surfaceClass.end(), 0);
+    }
+
+    // Trades the rendered frame for another buffer (resized to match), the pipelined loop
+    // renders into one buffer while the previous one is still being written out. When scaled
+    // the frame is stretched into it instead, the small one stays here.
+    void swapFrame(FrameBuffer& other) {
+        if (scaled()) {
+            if (other.width != outputWidth || other.height != outputHeight) other.resize(outputWidth, outputHeight);
+            other.upscaleFrom(frame);
+            return;
+        }
+        if (other.width != width || other.height != height) other.resize(width, height);
+        std::swap(frame, other);
+    }
+
+    // Starfield
+    void renderStars();
+
+    // How far a pixel's footprint stretches across the surface (depth, widened towards the limb
+    // where the surface is seen edge on). Times mipScale that's texels per pixel.
+    static double surfaceFootprint(double depth, const Vec3& normal, const Vec3& rayDir) {
+        return depth / std::max(1e-3, -normal.dot(rayDir));
+    }
+
+    // One pixel of the ray casting pipeline. Only touches cell (x, y) so tiles can run in parallel.
+    template <bool Color, bool Clouds>
+    void shadePixel(const Earth& earth, int x, int y, const Vec3& lightDir, ProfileTile& prof);
+
+    // Same for a row of pixels in precision T
+    template <typename T, bool Color, bool Clouds>
+    void shadeRow(const Earth& earth, int x0, int x1, int y, ProfileTile& prof);
+
+    // Same for color and mono, the color just gets ignored when printing without color
+    template <typename T>
+    void applyClouds(int i, T cloudValue) {
+        if (cloudValue > T(0.1)) {
+            frame.colors[i] = ColorIndex::BrightWhite;
+            if (cloudValue > T(0.7)) frame.glyphs[i] = '@';
+            else if (cloudValue > T(0.3)) frame.glyphs[i] = '%';
+            else frame.glyphs[i] = '.';
+        }
+    }
+
+    // Land and city light lookups for shadeSurface. Double goes through Earth as always, float
+    // and Fixed through the frame's texel scales so they stay in their own type.
+    char textureChar(const Earth& earth, double lat_rad, double lon_rad, int level) const {
+        return earth.getTextureCharLatLon(lat_rad, lon_rad, level);
+    }
+
+    template <typename T>
+    char textureChar(const Earth& earth, T lat_rad, T lon_rad, int level) const {
+        return earth.getTextureCharLatLon(lat_rad, lon_rad, scalarShading(T()).texture[level], level);
+    }
+
+    bool cityLight(const Earth& earth, double lat_rad, double lon_rad) const {
+        return earth.hasCityLight(lat_rad, lon_rad);
+    }
+
+    template <typename T>
+    bool cityLight(const Earth& earth, T lat_rad, T lon_rad) const {
+        return earth.hasCityLight(lat_rad, lon_rad, scalarShading(T()).cityLights);
+    }
+
+    // Texture, lighting, clouds and night side for a visible surface point, in the precision
+    // of the arguments. lat_rad/lon_rad are texture coordinates, i.e. with the globe's spin
+    // already applied.
+    template <bool Color, bool Clouds, typename T>
+    void shadeSurface(const Earth& earth, int i, T lat_rad, T lon_rad, int textureLevel, T diffuse);
+
+    // Picks the specialization at run time, for callers where the body changes per pixel (scenes)
+    // or that only touch a few cells (antialiasing)
+    void shadeSurface(const Earth& earth, int i, double lat_rad, double lon_rad, int textureLevel, double diffuse);
+
+    void preparePacketScene(const Earth& earth, const Vec3& lightDir);
+
+    // Same as a run of shadePixel calls but the geometry goes through the packet kernel
+    template <bool Color, bool Clouds>
+    void shadeRowPacket(const Earth& earth, int x0, int x1, int y, ProfileTile& prof);
+
+    void buildCacheTile(const Earth& earth, int tile);
+    void updateGeometryCache(const Earth& earth, int tileCount);
+    template <typename T, bool Color, bool Clouds>
+    void renderTile(const Earth& earth, int tile, const Vec3& lightDir);
+
+    // The rows of a tile on the scalar path, picked by the precision argument like scalarScene:
+    // double keeps Earth::intersectRay so it matches the cache and antialiasing exactly, float
+    // and Fixed go through shadeRow. Only the paths that run get instantiated.
+    template <bool Color, bool Clouds>
+    void renderRows(const Earth& earth, const CellRect& rect, const Vec3& lightDir, ProfileTile& prof, double);
+    template <bool Color, bool Clouds, typename T>
+    void renderRows(const Earth& earth, const CellRect& rect, const Vec3& lightDir, ProfileTile& prof, T);
+
+    // Adaptive AA pass: finds cells whose neighbours disagree on hit/miss or land/ocean and
+    // re-shades just those from a grid of sub-cell rays
+    void antialias(const Earth& earth, const Vec3& lightDir);
+    void refineCell(const Earth& earth, int i, int samples, const Vec3& lightDir);
+
+    // Ray Casting Rendering Pipeline
+    void render(const Earth& earth);
+
+    // Same picture, but only the footprint gets cleared and ray-cast when the frame buffer
+    // still holds this background from an earlier frame
+    void renderIncremental(const Earth& earth);
+
+    // renderIncremental's three steps, for callers that time clearing, stars and surface apart
+    struct IncrementalStep {
+        CellRect rect;  // the globe's footprint
+        uint64_t key;   // background key, 0 when the background is redrawn every frame
+        bool fresh;     // the whole buffer was cleared and needs all of its stars
+    };
+    IncrementalStep clearIncremental(const Earth& earth);
+    void renderIncrementalStars(const IncrementalStep& step);
+    void renderIncrementalSurface(const Earth& earth, const IncrementalStep& step);
+
+    // The globe itself, on top of whatever is already in the frame
+    void renderSurface(const Earth& earth);
+
+    // Same pipeline for a whole scene of bodies. Scalar rays only: packet tracing, the geometry
+    // cache, antialiasing and incremental rendering are single globe features.
+    void render(const Scene& scene);
+
+    void renderSurface(const Scene& scene);
+    void shadeScenePixel(const Scene& scene, int x, int y, const Vec3& lightDir, double angle, ProfileTile& prof);
+
+    // Angle one character cell covers
+    double pixelAngle() const;
+
+    // Encode the frame without writing it anywhere (benchmarks, tests)
+    const std::string& encodeFrame() {
+        return encodeFrame(getOutputFrame());
+    }
+
+    // Encoding only touches the encoder, banner and overlay, so another thread can encode a
+    // swapped out frame while this one renders the next (even across a resize)
+    const std::string& encodeFrame(const FrameBuffer& other) {
+        if (other.width != bannerWidth) {
+            banner = makeBanner(other.width, useColor);
+            bannerWidth = other.width;
+        }
+        encoder.setOverlay(overlayLine.substr(0, other.width));
+        return encoder.encode(other, useColor, banner);
+    }
+
+    // Terminal out
+    void display() {
+        display(getOutputFrame(), 1);
+    }
+
+    void display(const FrameBuffer& other, int fd) {
+        {
+            ProfileScope scope(profiler, ProfileStage::Encode);
+            encodeFrame(other);
+        }
+        ProfileScope scope(profiler, ProfileStage::Write);
+        encoder.writeTo(fd);
+        if (profiler.isEnabled()) profiler.add(ProfileCounter::Bytes, encoder.getLastFrameBytes());
+    }
+};
@@ -0,0 +1,102 @@
+#include "bvh.h"
+
+#include <limits>
+
+namespace {
+
+double axisOf(const Vec3& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+void growNode(Bvh::Node& node, const Bvh::Node& child) {
+    for (int axis = 0; axis < 3; axis++) {
+        node.lo[axis] = std::min(node.lo[axis], child.lo[axis]);
+        node.hi[axis] = std::max(node.hi[axis], child.hi[axis]);
+    }
+}
+
+void resetBounds(Bvh::Node& node) {
+    for (int axis = 0; axis < 3; axis++) {
+        node.lo[axis] = std::numeric_limits<double>::max();
+        node.hi[axis] = -std::numeric_limits<double>::max();
+    }
+}
+
+}  // namespace
+
+void Bvh::fitLeaf(Node& node, const std::vector<Sphere>& spheres) const {
+    resetBounds(node);
+    for (int k = 0; k < node.count; k++) {
+        const Sphere& sphere = spheres[items[node.first + k]];
+        for (int axis = 0; axis < 3; axis++) {
+            node.lo[axis] = std::min(node.lo[axis], axisOf(sphere.center, axis) - sphere.radius);
+            node.hi[axis] = std::max(node.hi[axis], axisOf(sphere.center, axis) + sphere.radius);
+        }
+    }
+}
+
+void Bvh::build(const std::vector<Sphere>& spheres) {
+    nodes.clear();
+    items.resize(spheres.size());
+    for (size_t i = 0; i < spheres.size(); i++) items[i] = static_cast<int>(i);
+    if (spheres.empty()) return;
+    nodes.reserve(2 * spheres.size());
+    nodes.push_back(Node());
+    buildNode(0, spheres, 0, static_cast<int>(spheres.size()));
+}
+
+void Bvh::buildNode(int nodeIndex, const std::vector<Sphere>& spheres, int first, int count) {
+    if (count <= LEAF_SIZE) {
+        nodes[nodeIndex].first = first;
+        nodes[nodeIndex].count = count;
+        fitLeaf(nodes[nodeIndex], spheres);
+        return;
+    }
+
+    double lo[3], hi[3];
+    for (int axis = 0; axis < 3; axis++) {
+        lo[axis] = std::numeric_limits<double>::max();
+        hi[axis] = -std::numeric_limits<double>::max();
+    }
+    for (int k = first; k < first + count; k++) {
+        for (int axis = 0; axis < 3; axis++) {
+            double c = axisOf(spheres[items[k]].center, axis);
+            lo[axis] = std::min(lo[axis], c);
+            hi[axis] = std::max(hi[axis], c);
+        }
+    }
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (hi[a] - lo[a] > hi[axis] - lo[axis]) axis = a;
+    }
+    int half = count / 2;
+    std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+                     [&](int a, int b) { return axisOf(spheres[a].center, axis) < axisOf(spheres[b].center, axis); });
+
+    int left = static_cast<int>(nodes.size());
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    nodes[nodeIndex].first = left;
+    nodes[nodeIndex].count = 0;
+    buildNode(left, spheres, first, half);
+    buildNode(left + 1, spheres, first + half, count - half);
+
+    Node& node = nodes[nodeIndex];
+    resetBounds(node);
+    growNode(node, nodes[left]);
+    growNode(node, nodes[left + 1]);
+}
+
+void Bvh::refit(const std::vector<Sphere>& spheres) {
+    // Children always come after their parent, so walking backwards is bottom up
+    for (int n = static_cast<int>(nodes.size()) - 1; n >= 0; n--) {
+        Node& node = nodes[n];
+        if (node.count > 0) {
+            fitLeaf(node, spheres);
+        } else {
+            resetBounds(node);
+            growNode(node, nodes[node.first]);
+            growNode(node, nodes[node.first + 1]);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "vec3.h"
+
+// Bounding volume hierarchy over spheres. Nodes live in one flat array, a node's two children
+// are stored next to each other after it, so a reverse sweep over the array refits bottom up.
+class Bvh {
+public:
+    struct Sphere {
+        Vec3 center;
+        double radius;
+    };
+
+    struct Node {
+        double lo[3], hi[3];
+        int first;  // leaf: first entry in items, inner: index of the left child (right is first + 1)
+        int count;  // items in a leaf, 0 for inner nodes
+    };
+
+private:
+    static constexpr int LEAF_SIZE = 2;
+
+    std::vector<Node> nodes;
+    std::vector<int> items;  // sphere indices, grouped by leaf
+
+    void buildNode(int nodeIndex, const std::vector<Sphere>& spheres, int first, int count);
+    void fitLeaf(Node& node, const std::vector<Sphere>& spheres) const;
+
+    // Slab test, entry distance in tNear when the ray touches the box before tMax
+    static bool hitBox(const Node& node, const double origin[3], const double invDir[3], double tMax, double& tNear) {
+        double t0 = 0.0, t1 = tMax;
+        for (int axis = 0; axis < 3; axis++) {
+            double a = (node.lo[axis] - origin[axis]) * invDir[axis];
+            double b = (node.hi[axis] - origin[axis]) * invDir[axis];
+            if (a > b) std::swap(a, b);
+            t0 = std::max(t0, a);
+            t1 = std::min(t1, b);
+            // NaN (0 * inf on a box face) fails both comparisons and keeps the box
+        }
+        tNear = t0;
+        return t0 <= t1;
+    }
+
+public:
+    // Median split on the longest axis of the centers, O(n log n)
+    void build(const std::vector<Sphere>& spheres);
+
+    // Same tree, bounds recomputed for moved spheres. Fast, but the tree gets looser the further
+    // things drift from where they were at build time.
+    void refit(const std::vector<Sphere>& spheres);
+
+    bool empty() const {
+        return nodes.empty();
+    }
+
+    const std::vector<Node>& getNodes() const {
+        return nodes;
+    }
+
+    // Closest-hit traversal. test(sphereIndex, tMax) checks one sphere and returns true (after
+    // lowering tMax) if it's hit closer. Nearer children go first so far subtrees get culled.
+    template <typename Test>
+    bool traverse(const Vec3& origin, const Vec3& dir, double& tMax, Test test) const {
+        if (nodes.empty()) return false;
+        const double o[3] = {origin.x, origin.y, origin.z};
+        const double inv[3] = {1.0 / dir.x, 1.0 / dir.y, 1.0 / dir.z};
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        bool hit = false;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            double tNear;
+            if (!hitBox(node, o, inv, tMax, tNear)) continue;
+            if (node.count > 0) {
+                for (int k = 0; k < node.count; k++) {
+                    if (test(items[node.first + k], tMax)) hit = true;
+                }
+                continue;
+            }
+            double nearLeft, nearRight;
+            bool left = hitBox(nodes[node.first], o, inv, tMax, nearLeft);
+            bool right = hitBox(nodes[node.first + 1], o, inv, tMax, nearRight);
+            // Push the far one first so the near one gets popped next
+            if (left && right) {
+                bool leftFirst = nearLeft <= nearRight;
+                stack[top++] = leftFirst ? node.first + 1 : node.first;
+                stack[top++] = leftFirst ? node.first : node.first + 1;
+            } else if (left) {
+                stack[top++] = node.first;
+            } else if (right) {
+                stack[top++] = node.first + 1;
+            }
+        }
+        return hit;
+    }
+};
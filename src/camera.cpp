@@ -0,0 +1,48 @@
+#include "camera.h"
+
+void Camera::getBasis(Vec3& forward, Vec3& right, Vec3& trueUp, double& widthAtDist1, double& heightAtDist1) const {
+    forward = (lookAt - position).normalize();
+    right = forward.cross(up).normalize();
+    trueUp = right.cross(forward);
+
+    double fovRadians = fov * PI / 180.0;
+    heightAtDist1 = 2.0 * std::tan(fovRadians / 2.0);
+    widthAtDist1 = heightAtDist1 * aspectRatio;
+}
+
+Vec3 Camera::rayDirection(double screenX, double screenY) const {
+    Vec3 forward, right, trueUp;
+    double widthAtDist1, heightAtDist1;
+    getBasis(forward, right, trueUp, widthAtDist1, heightAtDist1);
+
+    Vec3 dir = forward
+            + right * (screenX * widthAtDist1)
+            + trueUp * (screenY * heightAtDist1);
+
+    return dir.normalize();
+}
+
+// Per axis it's a 2D problem: the two tangents from the eye to the circle the sphere makes in the
+// forward/right (or forward/up) plane
+static bool tangentBounds(double side, double depth, double radius, double planeSize, double& lo, double& hi) {
+    double distance = std::sqrt(side * side + depth * depth);
+    if (distance <= radius) return false;
+    double center = std::atan2(side, depth);
+    double spread = std::asin(radius / distance);
+    if (center - spread <= -PI / 2 || center + spread >= PI / 2) return false;
+    lo = std::tan(center - spread) / planeSize;
+    hi = std::tan(center + spread) / planeSize;
+    return true;
+}
+
+bool Camera::projectSphere(const Vec3& center, double radius, double& minX, double& maxX, double& minY,
+                           double& maxY) const {
+    Vec3 forward, right, trueUp;
+    double widthAtDist1, heightAtDist1;
+    getBasis(forward, right, trueUp, widthAtDist1, heightAtDist1);
+
+    Vec3 toCenter = center - position;
+    double depth = toCenter.dot(forward);
+    return tangentBounds(toCenter.dot(right), depth, radius, widthAtDist1, minX, maxX)
+        && tangentBounds(toCenter.dot(trueUp), depth, radius, heightAtDist1, minY, maxY);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "vec3.h"
+
+// Camera [o]
+class Camera {
+public:
+    Vec3 position;
+    Vec3 lookAt;
+    Vec3 up;
+    double fov;
+    double aspectRatio;
+
+    Camera(const Vec3& pos, const Vec3& look, const Vec3& u, double f, double ar)
+        : position(pos), lookAt(look), up(u), fov(f), aspectRatio(ar) {}
+
+    // View basis and the size of the image plane one unit in front of the camera
+    void getBasis(Vec3& forward, Vec3& right, Vec3& trueUp, double& widthAtDist1, double& heightAtDist1) const;
+
+    // Ray Direction/Persp Projection
+    Vec3 rayDirection(double screenX, double screenY) const;
+
+    // Screen space bounds (the -1..1 coordinates rayDirection takes) of a sphere's silhouette.
+    // False if the sphere isn't entirely in front of the camera.
+    bool projectSphere(const Vec3& center, double radius, double& minX, double& maxX, double& minY,
+                       double& maxY) const;
+};
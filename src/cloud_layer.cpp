@@ -0,0 +1,51 @@
+#include "cloud_layer.h"
+
+void CloudLayer::bake(double cloudPhase) {
+    static const double latFreq[OCTAVES] = {8.0, 18.0, 30.0};
+    static const double latShift[OCTAVES] = {0.5, -0.8, 1.2};
+    static const double lonFreq[OCTAVES] = {6.0, 14.0, 25.0};
+    static const double lonShift[OCTAVES] = {0.4, -0.6, 1.0};
+    // Octave weights are folded into the latitude table
+    static const double weight[OCTAVES] = {0.4, 0.3, 0.3};
+
+    latTable.resize((latSamples + 1) * OCTAVES);
+    lonTable.resize((lonSamples + 1) * OCTAVES);
+    // Samples are evenly spaced, so each octave is a fixed-step rotation: two sin/cos to set
+    // up and a complex multiply per sample instead of a trig call per sample
+    for (int k = 0; k < OCTAVES; k++) {
+        double step = latFreq[k] * PI / latSamples;
+        double stepSin = std::sin(step), stepCos = std::cos(step);
+        double start = -PI / 2.0 * latFreq[k] + cloudPhase * latShift[k];
+        double s = std::sin(start), c = std::cos(start);
+        for (int i = 0; i <= latSamples; i++) {
+            latTable[i * OCTAVES + k] = static_cast<float>(weight[k] * s);
+            double next = s * stepCos + c * stepSin;
+            c = c * stepCos - s * stepSin;
+            s = next;
+        }
+    }
+    for (int k = 0; k < OCTAVES; k++) {
+        double step = lonFreq[k] * 2.0 * PI / lonSamples;
+        double stepSin = std::sin(step), stepCos = std::cos(step);
+        double start = -PI * lonFreq[k] + cloudPhase * lonShift[k];
+        double s = std::sin(start), c = std::cos(start);
+        for (int i = 0; i <= lonSamples; i++) {
+            lonTable[i * OCTAVES + k] = static_cast<float>(c);
+            double next = s * stepCos + c * stepSin;
+            c = c * stepCos - s * stepSin;
+            s = next;
+        }
+    }
+    floatLatScale = static_cast<float>(latSamples / PI);
+    floatLonScale = static_cast<float>(lonSamples / (2.0 * PI));
+    // A few thousand conversions next to as many sin/cos steps, not worth skipping when unused
+    fixedLatTable.resize(latTable.size());
+    fixedLonTable.resize(lonTable.size());
+    for (size_t i = 0; i < latTable.size(); i++) fixedLatTable[i] = Fixed(latTable[i]);
+    for (size_t i = 0; i < lonTable.size(); i++) fixedLonTable[i] = Fixed(lonTable[i]);
+    fixedLatScale = Fixed(latSamples / PI);
+    fixedLonScale = Fixed(lonSamples / (2.0 * PI));
+    baked = true;
+    bakedPhase = cloudPhase;
+    framesSinceBake = 0;
+}
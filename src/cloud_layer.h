@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "fixed_point.h"
+#include "vec3.h"
+
+// Cloud layer. Each noise octave is sin(lat * a + phase * p) * cos(lon * b + phase * q), which
+// splits into a latitude table and a longitude table. Those get baked for the current phase and
+// a lit pixel just interpolates six entries instead of calling sin/cos six times.
+class CloudLayer {
+private:
+    static constexpr int OCTAVES = 3;
+
+    int latSamples, lonSamples;
+    int refreshInterval;
+    int framesSinceBake;
+    bool baked;
+    double bakedPhase;
+    // interleaved by octave: table[index * OCTAVES + octave], one extra sample for interpolation
+    std::vector<float> latTable;
+    std::vector<float> lonTable;
+    // Samples per radian for the float path, and everything again in fixed point, set by bake()
+    float floatLatScale, floatLonScale;
+    std::vector<Fixed> fixedLatTable, fixedLonTable;
+    Fixed fixedLatScale, fixedLonScale;
+
+    void bake(double cloudPhase);
+
+    void tables(const float*& lat, const float*& lon, float& latScale, float& lonScale) const {
+        lat = latTable.data();
+        lon = lonTable.data();
+        latScale = floatLatScale;
+        lonScale = floatLonScale;
+    }
+
+    void tables(const Fixed*& lat, const Fixed*& lon, Fixed& latScale, Fixed& lonScale) const {
+        lat = fixedLatTable.data();
+        lon = fixedLonTable.data();
+        latScale = fixedLatScale;
+        lonScale = fixedLonScale;
+    }
+
+public:
+    CloudLayer(int latRes = 1024, int lonRes = 2048)
+        : latSamples(std::max(1, latRes)), lonSamples(std::max(1, lonRes)), refreshInterval(1),
+          framesSinceBake(0), baked(false), bakedPhase(0.0), floatLatScale(0.0f), floatLonScale(0.0f) {}
+
+    void setResolution(int latRes, int lonRes) {
+        latSamples = std::max(1, latRes);
+        lonSamples = std::max(1, lonRes);
+        baked = false;
+    }
+
+    // Re-bake every n frames, in between the clouds ride along with the surface
+    void setRefreshInterval(int frames) {
+        refreshInterval = std::max(1, frames);
+    }
+
+    // Once per frame, before any density() calls
+    void update(double cloudPhase) {
+        framesSinceBake++;
+        if (!baked || (framesSinceBake >= refreshInterval && cloudPhase != bakedPhase)) bake(cloudPhase);
+    }
+
+    // Thresholded cloud cover at a spun lat/lon (radians), 0 where there are no clouds
+    double density(double latRad, double lonRad) const {
+        double latPos = (latRad + PI / 2.0) * (latSamples / PI);
+        double lonPos = (lonRad + PI) * (lonSamples / (2.0 * PI));
+        int latIdx = std::max(0, std::min(latSamples - 1, static_cast<int>(latPos)));
+        int lonIdx = std::max(0, std::min(lonSamples - 1, static_cast<int>(lonPos)));
+        float latFrac = static_cast<float>(latPos - latIdx);
+        float lonFrac = static_cast<float>(lonPos - lonIdx);
+        const float* lat0 = &latTable[latIdx * OCTAVES];
+        const float* lon0 = &lonTable[lonIdx * OCTAVES];
+
+        float cloudValue = 0.0f;
+        for (int k = 0; k < OCTAVES; k++) {
+            float s = lat0[k] + latFrac * (lat0[k + OCTAVES] - lat0[k]);
+            float c = lon0[k] + lonFrac * (lon0[k + OCTAVES] - lon0[k]);
+            cloudValue += s * c;
+        }
+        cloudValue = (cloudValue + 0.3f);
+        return std::max(0.0f, cloudValue - 0.6f) * 2.0f;
+    }
+
+    // Same for float and fixed point shading, every step in T
+    template <typename T>
+    T density(T latRad, T lonRad) const {
+        const T* latData;
+        const T* lonData;
+        T latScale, lonScale;
+        tables(latData, lonData, latScale, lonScale);
+        T latPos = (latRad + T(PI / 2.0)) * latScale;
+        T lonPos = (lonRad + T(PI)) * lonScale;
+        int latIdx = std::max(0, std::min(latSamples - 1, static_cast<int>(latPos)));
+        int lonIdx = std::max(0, std::min(lonSamples - 1, static_cast<int>(lonPos)));
+        T latFrac = latPos - T(latIdx);
+        T lonFrac = lonPos - T(lonIdx);
+        const T* lat0 = &latData[latIdx * OCTAVES];
+        const T* lon0 = &lonData[lonIdx * OCTAVES];
+
+        T cloudValue = T();
+        for (int k = 0; k < OCTAVES; k++) {
+            T s = lat0[k] + latFrac * (lat0[k + OCTAVES] - lat0[k]);
+            T c = lon0[k] + lonFrac * (lon0[k + OCTAVES] - lon0[k]);
+            cloudValue = cloudValue + s * c;
+        }
+        T cover = cloudValue + T(0.3) - T(0.6);
+        return cover < T() ? T() : cover * T(2);
+    }
+};
@@ -0,0 +1,43 @@
+#include "color.h"
+
+namespace Color {
+    const std::string RESET = "\033[0m";
+    const std::string BLACK = "\033[30m";
+    const std::string RED = "\033[31m";
+    const std::string GREEN = "\033[32m";
+    const std::string YELLOW = "\033[33m";
+    const std::string BLUE = "\033[34m";
+    const std::string MAGENTA = "\033[35m";
+    const std::string CYAN = "\033[36m";
+    const std::string WHITE = "\033[37m";
+    const std::string BRIGHT_BLUE = "\033[94m";
+    const std::string BRIGHT_GREEN = "\033[92m";
+    const std::string BRIGHT_RED = "\033[91m";
+    const std::string BRIGHT_YELLOW = "\033[93m";
+    const std::string BRIGHT_MAGENTA = "\033[95m";
+    const std::string BRIGHT_CYAN = "\033[96m";
+    const std::string BRIGHT_WHITE = "\033[97m";
+}
+
+const std::string& colorCode(ColorIndex color) {
+    static const std::string* const codes[] = {
+        &Color::RESET,
+        &Color::BLACK,
+        &Color::RED,
+        &Color::GREEN,
+        &Color::YELLOW,
+        &Color::BLUE,
+        &Color::MAGENTA,
+        &Color::CYAN,
+        &Color::WHITE,
+        &Color::BRIGHT_BLUE,
+        &Color::BRIGHT_GREEN,
+        &Color::BRIGHT_RED,
+        &Color::BRIGHT_YELLOW,
+        &Color::BRIGHT_MAGENTA,
+        &Color::BRIGHT_CYAN,
+        &Color::BRIGHT_WHITE
+    };
+    // Masked so a color byte from a corrupt sequence file can't read past the table
+    return *codes[static_cast<int>(color) & 15];
+}
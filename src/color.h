@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// ANSI Escape Codes
+namespace Color {
+    extern const std::string RESET;
+    extern const std::string BLACK;
+    extern const std::string RED;
+    extern const std::string GREEN;
+    extern const std::string YELLOW;
+    extern const std::string BLUE;
+    extern const std::string MAGENTA;
+    extern const std::string CYAN;
+    extern const std::string WHITE;
+    extern const std::string BRIGHT_BLUE;
+    extern const std::string BRIGHT_GREEN;
+    extern const std::string BRIGHT_RED;
+    extern const std::string BRIGHT_YELLOW;
+    extern const std::string BRIGHT_MAGENTA;
+    extern const std::string BRIGHT_CYAN;
+    extern const std::string BRIGHT_WHITE;
+}
+
+// One byte per cell instead of a std::string, maps 1:1 onto the Color codes above
+enum class ColorIndex : uint8_t {
+    Reset,
+    Black,
+    Red,
+    Green,
+    Yellow,
+    Blue,
+    Magenta,
+    Cyan,
+    White,
+    BrightBlue,
+    BrightGreen,
+    BrightRed,
+    BrightYellow,
+    BrightMagenta,
+    BrightCyan,
+    BrightWhite
+};
+
+const std::string& colorCode(ColorIndex color);
@@ -0,0 +1,185 @@
+#include "earth.h"
+
+#include "random.h"
+
+namespace {
+
+// The default seed keeps the map it had when this was srand() / rand(), any other seed gets
+// SplitMix like everything else
+class ContinentRandom {
+private:
+    bool legacy;
+    GlibcRand glibc;
+    SplitMix mix;
+
+public:
+    explicit ContinentRandom(unsigned seed) : legacy(seed == Earth::DEFAULT_SEED), glibc(seed), mix(seed) {}
+
+    int nextInt(int n) {
+        return legacy ? glibc.nextInt(n) : mix.nextInt(n);
+    }
+};
+
+}  // namespace
+
+void Earth::createSimplifiedTexture() {
+    const int latRes = texture.getLatRes();
+    const int lonRes = texture.getLonRes();
+    const double latScale = latRes / 180.0;
+    const double lonScale = lonRes / 360.0;
+    texture.resize(latRes, lonRes);
+    ContinentRandom rng(textureSeed);
+
+    // texel range covering [from, to) degrees
+    auto firstTexel = [](double deg, double scale) { return static_cast<int>(std::ceil(deg * scale)); };
+    auto wrapLon = [lonRes](int lon) { return ((lon % lonRes) + lonRes) % lonRes; };
+
+    for (int i = 0; i < 5; i++) {
+        int centerLat = 30 + rng.nextInt(120);
+        int centerLon = rng.nextInt(360);
+        int size = 15 + rng.nextInt(20);
+        for (int latT = firstTexel(centerLat - size, latScale); latT < firstTexel(centerLat + size, latScale); latT++) {
+            if (latT < 0 || latT >= latRes) continue;
+            double lat = latT / latScale;
+            for (int lonT = firstTexel(centerLon - size, lonScale); lonT < firstTexel(centerLon + size, lonScale); lonT++) {
+                double lon = lonT / lonScale;
+                double latDist = (lat - centerLat) / static_cast<double>(size);
+                double lonDist = (lon - centerLon) / static_cast<double>(size);
+                double distance = std::sqrt(latDist * latDist + lonDist * lonDist);
+                double noise = 0.3 * std::sin(lat * 0.1) * std::cos(lon * 0.1);
+                noise += 0.2 * std::sin(lat * 0.2 + 0.5) * std::cos(lon * 0.2 + 0.3);
+                noise += 0.1 * std::sin(lat * 0.4 + 1.0) * std::cos(lon * 0.4 + 0.7);
+                if (distance < 0.8 + noise) texture.set(latT, wrapLon(lonT), true);
+            }
+        }
+    }
+     for (int i = 0; i < 12; i++) {
+        int centerLat = 20 + rng.nextInt(140);
+        int centerLon = rng.nextInt(360);
+        int size = 3 + rng.nextInt(5);
+        for (int latT = firstTexel(centerLat - size, latScale); latT < firstTexel(centerLat + size, latScale); latT++) {
+            if (latT < 0 || latT >= latRes) continue;
+            double lat = latT / latScale;
+            for (int lonT = firstTexel(centerLon - size, lonScale); lonT < firstTexel(centerLon + size, lonScale); lonT++) {
+                double lon = lonT / lonScale;
+                double latDist = (lat - centerLat) / static_cast<double>(size);
+                double lonDist = (lon - centerLon) / static_cast<double>(size);
+                double distance = std::sqrt(latDist * latDist + lonDist * lonDist);
+                double noise = 0.2 * std::sin(lat * 0.3) * std::cos(lon * 0.3);
+                if (distance < 0.7 + noise) texture.set(latT, wrapLon(lonT), true);
+            }
+        }
+    }
+    for (int latT = 0; latT < std::min(latRes, firstTexel(20, latScale)); latT++) {
+        double lat = latT / latScale;
+        for (int lonT = 0; lonT < lonRes; lonT++) {
+            double noise = 0.2 * std::sin(lonT / lonScale * 0.1);
+            if (lat < 15 + noise * 5) texture.set(latT, lonT, true);
+        }
+    }
+    for (int latT = firstTexel(160, latScale); latT < latRes; latT++) {
+        double lat = latT / latScale;
+        for (int lonT = 0; lonT < lonRes; lonT++) {
+            double noise = 0.2 * std::sin(lonT / lonScale * 0.1);
+            if (lat > 165 - noise * 5) texture.set(latT, lonT, true);
+        }
+    }
+    for (int i = 0; i < 25; i++) {
+        int centerLat = 30 + rng.nextInt(120);
+        int centerLon = rng.nextInt(360);
+        int size = 2 + rng.nextInt(8);
+        int centerLatT = std::min(latRes - 1, static_cast<int>(centerLat * latScale));
+        int centerLonT = std::min(lonRes - 1, static_cast<int>(centerLon * lonScale));
+        if (!texture.get(centerLatT, centerLonT)) continue;
+        for (int latT = firstTexel(centerLat - size, latScale); latT < firstTexel(centerLat + size, latScale); latT++) {
+            if (latT < 0 || latT >= latRes) continue;
+            double lat = latT / latScale;
+            for (int lonT = firstTexel(centerLon - size, lonScale); lonT < firstTexel(centerLon + size, lonScale); lonT++) {
+                double lon = lonT / lonScale;
+                double latDist = (lat - centerLat) / static_cast<double>(size);
+                double lonDist = (lon - centerLon) / static_cast<double>(size);
+                double distance = std::sqrt(latDist * latDist + lonDist * lonDist);
+                if (distance < 0.8) texture.set(latT, wrapLon(lonT), false);
+            }
+        }
+    }
+    texture.buildMips();
+    createCityLights();
+}
+
+void Earth::createCityLights() {
+    // Never finer than a degree, a city is a point light anyway
+    int latRes = std::min(180, texture.getLatRes());
+    int lonRes = std::min(360, texture.getLonRes());
+    cityLights.resize(latRes, lonRes);
+    for (int latT = 0; latT < latRes; latT++) {
+        double lat = (latT + 0.5) * 180.0 / latRes - 90.0;
+        if (std::abs(lat) > 63.0) continue;  // ice
+        for (int lonT = 0; lonT < lonRes; lonT++) {
+            double lon = (lonT + 0.5) * 360.0 / lonRes - 180.0;
+            // One land texel in 25, hashed from the texel so it doesn't depend on visiting order
+            uint64_t r = splitMix64(textureSeed ^ (static_cast<uint64_t>(latT) << 32 | lonT));
+            if (r % 25 == 0 && isLand(lat, lon)) cityLights.set(latT, lonT, true);
+        }
+    }
+}
+
+void Earth::rotate(double angleDegrees) {
+    rotationY += angleDegrees * PI / 180.0;
+    while (rotationY >= 2.0 * PI) rotationY -= 2.0 * PI;
+    while (rotationY < 0.0) rotationY += 2.0 * PI;
+}
+
+bool Earth::intersectRay(const Vec3& rayOrigin, const Vec3& rayDir, double& depth, Vec3& hitPoint, Vec3& normal) const {
+    Vec3 oc = rayOrigin - position;
+    double a = rayDir.dot(rayDir);
+    double b = 2.0 * oc.dot(rayDir);
+    double c = oc.dot(oc) - radius * radius;
+    double discriminant = b * b - 4 * a * c;
+
+    if (discriminant < 0) {
+        return false;
+    }
+
+    double sqrtDiscriminant = std::sqrt(discriminant);
+    double t1 = (-b - sqrtDiscriminant) / (2.0 * a);
+    double t2 = (-b + sqrtDiscriminant) / (2.0 * a);
+
+    double t = -1.0;
+    if (t1 >= 0) {
+        t = t1;
+    }
+    if (t2 >= 0 && (t < 0 || t2 < t)) {
+         t = t2;
+    }
+
+    if (t < 0) {
+        return false;
+    }
+
+
+    depth = t;
+    hitPoint = rayOrigin + rayDir * t;
+    normal = (hitPoint - position).normalize();
+    return true;
+}
+
+void Earth::baseLatLon(const Vec3& hitPoint, double& latRad, double& lonRad) const {
+    Vec3 dirFromCenter = (hitPoint - position).normalize();
+    latRad = std::asin(dirFromCenter.y);
+    lonRad = std::atan2(dirFromCenter.z, dirFromCenter.x);
+}
+
+char Earth::getTextureChar(const Vec3& hitPoint) const {
+    Vec3 rotatedPoint = ::rotate(hitPoint - position, Vec3(0, 1, 0), -rotationY);
+    Vec3 dirFromCenter = (rotatedPoint).normalize();
+    // Cartesian to Spherical
+    double lat = std::asin(dirFromCenter.y) * 180.0 / PI;
+    double lon = std::atan2(dirFromCenter.z, dirFromCenter.x) * 180.0 / PI;
+
+    if (isLand(lat, lon)) {
+        return '#';
+    } else {
+        return '~';
+    }
+}
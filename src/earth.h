@@ -0,0 +1,98 @@
+#pragma once
+
+#include "land_texture.h"
+#include "vec3.h"
+
+// Da Sphere (Earth)
+class Earth {
+public:
+    double radius;
+    Vec3 position;
+    double rotationY;
+    LandTexture texture;
+    unsigned textureSeed;  // different seeds, different continents
+    bool cloudy;
+    LandTexture cityLights;  // same bit layout as the land mask, set where a city shines at night
+    bool inhabited;          // moons and rocks keep the mask but never light it
+
+    // The seed the globe has always had, its continents still come from glibc's rand()
+    static constexpr unsigned DEFAULT_SEED = 42;
+
+    Earth(double r, const Vec3& pos, int textureLatRes = 180, int textureLonRes = 360, unsigned seed = DEFAULT_SEED)
+        : radius(r), position(pos), rotationY(0.0), texture(textureLatRes, textureLonRes), textureSeed(seed),
+          cloudy(true), inhabited(true) {
+        createSimplifiedTexture();
+    }
+
+    // Regenerates the continents at a new texture resolution
+    void setTextureResolution(int latRes, int lonRes) {
+        texture.resize(latRes, lonRes);
+        createSimplifiedTexture();
+    }
+
+    // Proc Texture Gen, Noise Pattern using sin/cos
+    // Shapes are laid out in degrees and rasterized at whatever resolution the texture has,
+    // 180x360 gives one texel per degree.
+    void createSimplifiedTexture();
+
+    // Scatters cities over the land mask, called at the end of createSimplifiedTexture
+    void createCityLights();
+
+    // texture Coordinate Mapping
+    bool isLand(double lat, double lon, int level = 0) const {
+        return texture.isLand(lat, lon, level);
+    }
+
+    // Mip level whose texels are about one pixel across, given how many level 0 texels a
+    // pixel covers (ilogb is floor(log2) without the log, Fixed brings its own)
+    template <typename T>
+    int textureLevel(T texelsPerPixel) const {
+        using std::ilogb;
+        int level = texelsPerPixel >= T(1) ? ilogb(texelsPerPixel) : 0;
+        return std::min(level, texture.getLevelCount() - 1);
+    }
+
+    void rotate(double angleDegrees);
+
+    // Ray Sphere Intersect
+    bool intersectRay(const Vec3& rayOrigin, const Vec3& rayDir, double& depth, Vec3& hitPoint, Vec3& normal) const;
+
+    // Latitude/longitude (radians) of a surface point with the spin left out. Spinning about Y
+    // only shifts longitude, so these can be cached per pixel and offset by spinLongitude().
+    void baseLatLon(const Vec3& hitPoint, double& latRad, double& lonRad) const;
+
+    // Base longitude -> texture longitude for the current rotationY, wrapped to [-PI, PI)
+    double spinLongitude(double baseLonRad) const {
+        double lon = baseLonRad + rotationY;
+        return lon - 2.0 * PI * std::floor((lon + PI) / (2.0 * PI));
+    }
+
+    // Same as getTextureChar but from already spun lat/lon, no rotation or trig
+    char getTextureCharLatLon(double latRad, double lonRad, int level = 0) const {
+        return isLand(latRad * 180.0 / PI, lonRad * 180.0 / PI, level) ? '#' : '~';
+    }
+
+    // Spun lat/lon in radians, level 0 only so the lights don't vanish towards the limb
+    bool hasCityLight(double latRad, double lonRad) const {
+        return inhabited && cityLights.isLand(latRad * 180.0 / PI, lonRad * 180.0 / PI);
+    }
+
+    // The same two for float and fixed point shading, with scales from LandTexture::texelScale
+    template <typename T>
+    char getTextureCharLatLon(T latRad, T lonRad, const TexelScale<T>& scale, int level) const {
+        return texture.isLandRad(latRad, lonRad, scale, level) ? '#' : '~';
+    }
+
+    template <typename T>
+    bool hasCityLight(T latRad, T lonRad, const TexelScale<T>& scale) const {
+        return inhabited && cityLights.isLandRad(latRad, lonRad, scale, 0);
+    }
+
+    // ASCIIIIIII
+    char getTextureChar(const Vec3& hitPoint) const;
+
+    // The sun goes round as the globe spins, that's the day/night line moving
+    Vec3 sunDirection() const {
+        return Vec3(std::cos(rotationY), 0.5, -std::sin(rotationY)).normalize();
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+
+// Q16.16 fixed point for boards without a decent FPU. Enough range for the scene (the camera is
+// 8 units out, squared distances stay well under 32768) and about 1.5e-5 of resolution, which
+// is far finer than a character cell. Products and quotients go through 64 bits.
+class Fixed {
+private:
+    int32_t raw;
+
+    struct Raw {};
+    constexpr Fixed(int32_t value, Raw) : raw(value) {}
+
+public:
+    static constexpr int FRACTION_BITS = 16;
+    static constexpr int32_t ONE = 1 << FRACTION_BITS;
+
+    // Rounds half away from zero like lround, but constexpr so literals like Fixed(0.8) in the
+    // shading code fold at compile time instead of doing double math per pixel
+    constexpr Fixed() : raw(0) {}
+    constexpr explicit Fixed(double value)
+        : raw(static_cast<int32_t>(value * ONE + (value < 0 ? -0.5 : 0.5))) {}
+    constexpr explicit Fixed(float value)
+        : raw(static_cast<int32_t>(value * ONE + (value < 0 ? -0.5f : 0.5f))) {}
+    constexpr explicit Fixed(int value) : raw(value * ONE) {}
+
+    static Fixed fromRaw(int32_t value) {
+        return Fixed(value, Raw());
+    }
+
+    int32_t getRaw() const {
+        return raw;
+    }
+
+    explicit operator double() const {
+        return raw * (1.0 / ONE);
+    }
+
+    explicit operator float() const {
+        return raw * (1.0f / ONE);
+    }
+
+    // Truncates towards zero like the float to int conversion
+    explicit operator int() const {
+        return raw < 0 ? -(-raw >> FRACTION_BITS) : raw >> FRACTION_BITS;
+    }
+
+    Fixed operator+(Fixed o) const {
+        return fromRaw(raw + o.raw);
+    }
+
+    Fixed operator-(Fixed o) const {
+        return fromRaw(raw - o.raw);
+    }
+
+    Fixed operator-() const {
+        return fromRaw(-raw);
+    }
+
+    Fixed operator*(Fixed o) const {
+        return fromRaw(static_cast<int32_t>((static_cast<int64_t>(raw) * o.raw) >> FRACTION_BITS));
+    }
+
+    Fixed operator/(Fixed o) const {
+        return fromRaw(static_cast<int32_t>(static_cast<int64_t>(raw) * (int64_t(1) << FRACTION_BITS) / o.raw));
+    }
+
+    bool operator<(Fixed o) const { return raw < o.raw; }
+    bool operator>(Fixed o) const { return raw > o.raw; }
+    bool operator<=(Fixed o) const { return raw <= o.raw; }
+    bool operator>=(Fixed o) const { return raw >= o.raw; }
+    bool operator==(Fixed o) const { return raw == o.raw; }
+    bool operator!=(Fixed o) const { return raw != o.raw; }
+};
+
+// Integer square root of the value shifted up by the fraction bits, bit by bit
+inline Fixed sqrt(Fixed v) {
+    if (v.getRaw() <= 0) return Fixed();
+    uint64_t n = static_cast<uint64_t>(v.getRaw()) << Fixed::FRACTION_BITS;
+    uint64_t root = 0;
+    uint64_t bit = uint64_t(1) << 46;
+    while (bit > n) bit >>= 2;
+    while (bit) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return Fixed::fromRaw(static_cast<int32_t>(root));
+}
+
+inline Fixed abs(Fixed v) {
+    return v.getRaw() < 0 ? -v : v;
+}
+
+// floor(log2(v)) from the top set bit, for picking mip levels. Like std::ilogb it wants v > 0.
+inline int ilogb(Fixed v) {
+    int bit = -Fixed::FRACTION_BITS;
+    for (uint32_t r = static_cast<uint32_t>(v.getRaw()); r > 1; r >>= 1) bit++;
+    return bit;
+}
+
+// Trig is polynomial too, so the fixed point path never touches float. Both are good to about
+// 1e-4 radians, a tenth of a texel on the biggest textures.
+
+// Abramowitz & Stegun 4.4.45: asin(x) = PI/2 - sqrt(1 - x) * cubic(x) for x in [0, 1]
+inline Fixed asin(Fixed v) {
+    Fixed x = abs(v);
+    if (x > Fixed(1)) x = Fixed(1);
+    Fixed poly = Fixed(1.5707288) + x * (Fixed(-0.2121144) + x * (Fixed(0.0742610) + x * Fixed(-0.0187293)));
+    Fixed r = Fixed(1.5707963267948966) - sqrt(Fixed(1) - x) * poly;
+    return v.getRaw() < 0 ? -r : r;
+}
+
+// atan on [0, 1] by an odd polynomial, the rest of the circle by symmetry
+inline Fixed atan2(Fixed y, Fixed x) {
+    Fixed ax = abs(x), ay = abs(y);
+    if (ax.getRaw() == 0 && ay.getRaw() == 0) return Fixed();
+    bool steep = ay > ax;
+    Fixed a = steep ? ax / ay : ay / ax;
+    Fixed a2 = a * a;
+    Fixed r = a * (Fixed(0.9998660) + a2 * (Fixed(-0.3302995) + a2 * (Fixed(0.1801410)
+                + a2 * (Fixed(-0.0851330) + a2 * Fixed(0.0208351)))));
+    if (steep) r = Fixed(1.5707963267948966) - r;
+    if (x.getRaw() < 0) r = Fixed(3.141592653589793) - r;
+    return y.getRaw() < 0 ? -r : r;
+}
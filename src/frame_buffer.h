@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "color.h"
+
+// Half open block of cells, [x0, x1) x [y0, y1)
+struct CellRect {
+    int x0, y0, x1, y1;
+
+    bool empty() const {
+        return x0 >= x1 || y0 >= y1;
+    }
+
+    bool contains(int x, int y) const {
+        return x >= x0 && x < x1 && y >= y0 && y < y1;
+    }
+
+    bool operator==(const CellRect& other) const {
+        return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1;
+    }
+
+    bool operator!=(const CellRect& other) const {
+        return !(*this == other);
+    }
+};
+
+// Read-only cells of a frame that lives somewhere else (a FrameBuffer, a mapped sequence file)
+struct FrameView {
+    int width, height;
+    const char* glyphs;
+    const ColorIndex* colors;
+    // Set by incremental rendering: every cell outside dirty is background that is the same in
+    // every frame with this key. 0 means unknown, the whole frame may have changed.
+    uint64_t backgroundKey;
+    CellRect dirty;
+
+    size_t cellCount() const {
+        return static_cast<size_t>(width) * height;
+    }
+
+    int index(int x, int y) const {
+        return y * width + x;
+    }
+};
+
+// Resizes v to n elements, growing the capacity at least twofold and never handing it back, so
+// a terminal being dragged bigger and smaller settles into its allocation after a few steps
+template <typename T>
+void resizeGeometric(std::vector<T>& v, size_t n) {
+    if (n > v.capacity()) v.reserve(std::max(n, v.capacity() * 2));
+    v.resize(n);
+}
+
+// Flat structure-of-arrays frame, cells stored row-major so a clear is a few memsets
+struct FrameBuffer {
+    int width, height;
+    std::vector<char> glyphs;
+    std::vector<ColorIndex> colors;
+    std::vector<float> depth;
+    uint64_t backgroundKey;  // see FrameView
+    CellRect dirty;
+
+    FrameBuffer(int w = 0, int h = 0) : width(0), height(0), backgroundKey(0), dirty() {
+        resize(w, h);
+    }
+
+    // In place, see resizeGeometric
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        size_t cells = static_cast<size_t>(w) * h;
+        resizeGeometric(glyphs, cells);
+        resizeGeometric(colors, cells);
+        resizeGeometric(depth, cells);
+        clear();
+    }
+
+    // Nearest neighbour copy of a smaller frame, stretched over all of this one. The dirty rect
+    // is stretched with it so incremental frames stay incremental.
+    void upscaleFrom(const FrameBuffer& source) {
+        for (int y = 0; y < height; y++) {
+            int sy = static_cast<int>(static_cast<long long>(y) * source.height / height);
+            const char* sourceGlyphs = &source.glyphs[source.index(0, sy)];
+            const ColorIndex* sourceColors = &source.colors[source.index(0, sy)];
+            int row = index(0, y);
+            for (int x = 0; x < width; x++) {
+                int sx = static_cast<int>(static_cast<long long>(x) * source.width / width);
+                glyphs[row + x] = sourceGlyphs[sx];
+                colors[row + x] = sourceColors[sx];
+            }
+        }
+        // Output x shows source x * sw / w, so source [x0, x1) lands on [ceil(x0 * w / sw), ceil(x1 * w / sw))
+        auto stretch = [](int v, int to, int from) {
+            return static_cast<int>((static_cast<long long>(v) * to + from - 1) / from);
+        };
+        backgroundKey = source.backgroundKey;
+        dirty.x0 = stretch(source.dirty.x0, width, source.width);
+        dirty.x1 = stretch(source.dirty.x1, width, source.width);
+        dirty.y0 = stretch(source.dirty.y0, height, source.height);
+        dirty.y1 = stretch(source.dirty.y1, height, source.height);
+    }
+
+    void clear() {
+        std::fill(glyphs.begin(), glyphs.end(), ' ');
+        std::fill(colors.begin(), colors.end(), ColorIndex::Reset);
+        std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+        markAllDirty();
+    }
+
+    // Just the cells in rect, the rest of the frame is left as it is
+    void clear(const CellRect& rect) {
+        for (int y = rect.y0; y < rect.y1; y++) {
+            size_t row = static_cast<size_t>(index(rect.x0, y));
+            size_t count = static_cast<size_t>(rect.x1 - rect.x0);
+            std::fill_n(glyphs.begin() + row, count, ' ');
+            std::fill_n(colors.begin() + row, count, ColorIndex::Reset);
+            std::fill_n(depth.begin() + row, count, std::numeric_limits<float>::max());
+        }
+    }
+
+    void markAllDirty() {
+        backgroundKey = 0;
+        dirty = fullRect();
+    }
+
+    CellRect fullRect() const {
+        CellRect r = {0, 0, width, height};
+        return r;
+    }
+
+    int index(int x, int y) const {
+        return y * width + x;
+    }
+
+    FrameView view() const {
+        FrameView v = {width, height, glyphs.data(), colors.data(), backgroundKey, dirty};
+        return v;
+    }
+};
@@ -0,0 +1,136 @@
+#include "frame_encoder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+void FrameEncoder::moveTo(int x, int y) {
+    char escape[32];
+    int n = std::snprintf(escape, sizeof(escape), "\033[%d;%dH", y + 1, x + 1);
+    out.append(escape, n);
+}
+
+void FrameEncoder::encodeFull(const FrameView& frame, bool useColor, const std::string& footer) {
+    // First frame (or after a resize) wipes the screen once, after that we just paint over it
+    if (!havePrevious) out += "\033[2J";
+    out += "\033[H";
+
+    int current = -1;
+    for (int y = 0; y < frame.height; y++) {
+        for (int x = 0; x < frame.width; x++) {
+            int i = frame.index(x, y);
+            if (useColor && static_cast<int>(frame.colors[i]) != current) {
+                current = static_cast<int>(frame.colors[i]);
+                out += colorCode(frame.colors[i]);
+            }
+            out += frame.glyphs[i];
+        }
+        out += '\n';
+    }
+    if (useColor) out += Color::RESET;
+    out += footer;
+}
+
+void FrameEncoder::encodeDelta(const FrameView& frame, const CellRect& rect, bool useColor,
+                               const std::string& footer) {
+    int current = -1;
+    int cursor = -1;
+    for (int y = rect.y0; y < rect.y1; y++) {
+        for (int x = rect.x0; x < rect.x1; x++) {
+            int i = frame.index(x, y);
+            if (frame.glyphs[i] == prevGlyphs[i] && frame.colors[i] == prevColors[i]) continue;
+            lastChangedCells++;
+            if (i != cursor) moveTo(x, y);
+            if (useColor && static_cast<int>(frame.colors[i]) != current) {
+                current = static_cast<int>(frame.colors[i]);
+                out += colorCode(frame.colors[i]);
+            }
+            out += frame.glyphs[i];
+            // Don't trust the cursor after the last column, terminals disagree on wrapping
+            cursor = (x + 1 < frame.width) ? i + 1 : -1;
+        }
+    }
+    if (useColor && current != -1) out += Color::RESET;
+    // Park the cursor under the footer like a full frame would
+    moveTo(0, frame.height + static_cast<int>(std::count(footer.begin(), footer.end(), '\n')));
+}
+
+const std::string& FrameEncoder::encode(const FrameView& frame, bool useColor, const std::string& footer) {
+    size_t cells = frame.cellCount();
+    // Worst case every cell gets a cursor move and a color code
+    out.reserve(cells * 24 + footer.size() + 64);
+    out.clear();
+
+    if (havePrevious && (frame.width != prevWidth || frame.height != prevHeight)) havePrevious = false;
+
+    // Same background as the last frame: nothing outside the dirty rect can have changed
+    CellRect rect = {0, 0, frame.width, frame.height};
+    bool sameBackground = frame.backgroundKey != 0 && frame.backgroundKey == prevBackgroundKey;
+    if (sameBackground) rect = frame.dirty;
+
+    bool delta = deltaMode && havePrevious;
+    lastChangedCells = 0;
+    if (delta) {
+        encodeDelta(frame, rect, useColor, footer);
+    } else {
+        encodeFull(frame, useColor, footer);
+        lastChangedCells = cells;
+    }
+    // Both leave the cursor on the line under the footer
+    if (!overlay.empty() && (!delta || overlayChanged)) {
+        out += "\033[2K";
+        out += overlay;
+        out += '\n';
+    } else if (overlay.empty() && overlayChanged) {
+        // Just turned off: wipe the old line, full frames don't clear the screen either. The
+        // cursor stays at its start, under the footer like it is without an overlay.
+        out += "\033[2K";
+    }
+    overlayChanged = false;
+
+    if (delta && sameBackground) {
+        for (int y = rect.y0; y < rect.y1; y++) {
+            int row = frame.index(rect.x0, y);
+            std::copy(frame.glyphs + row, frame.glyphs + row + (rect.x1 - rect.x0), prevGlyphs.begin() + row);
+            std::copy(frame.colors + row, frame.colors + row + (rect.x1 - rect.x0), prevColors.begin() + row);
+        }
+    } else {
+        prevGlyphs.assign(frame.glyphs, frame.glyphs + cells);
+        prevColors.assign(frame.colors, frame.colors + cells);
+    }
+    prevBackgroundKey = frame.backgroundKey;
+    prevWidth = frame.width;
+    prevHeight = frame.height;
+    havePrevious = true;
+
+    lastBytes = out.size();
+    totalBytes += lastBytes;
+    frames++;
+    return out;
+}
+
+bool FrameEncoder::writeTo(int fd) const {
+    #ifdef _WIN32
+    (void)fd;
+    size_t written = std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fflush(stdout);
+    return written == out.size();
+    #else
+    const char* data = out.data();
+    size_t left = out.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd, data, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        left -= static_cast<size_t>(n);
+    }
+    return true;
+    #endif
+}
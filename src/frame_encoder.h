@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "frame_buffer.h"
+
+// Terminal output stage. Builds a whole frame in one reusable byte buffer (cursor-home instead of
+// clearing, color codes only where the color changes) and hands it to the terminal in one write.
+// In delta mode only the cells that changed since the previous frame are sent, and when the frame
+// comes from incremental rendering only its dirty rect is compared at all.
+class FrameEncoder {
+private:
+    std::string out;
+    std::vector<char> prevGlyphs;
+    std::vector<ColorIndex> prevColors;
+    int prevWidth, prevHeight;
+    uint64_t prevBackgroundKey;
+    bool havePrevious;
+    bool deltaMode;
+    std::string overlay;
+    bool overlayChanged;
+    size_t lastBytes;
+    size_t lastChangedCells;
+    unsigned long long totalBytes;
+    unsigned long frames;
+
+    void moveTo(int x, int y);
+    void encodeFull(const FrameView& frame, bool useColor, const std::string& footer);
+    void encodeDelta(const FrameView& frame, const CellRect& rect, bool useColor, const std::string& footer);
+
+public:
+    FrameEncoder()
+        : prevWidth(0), prevHeight(0), prevBackgroundKey(0), havePrevious(false), deltaMode(false),
+          overlayChanged(false), lastBytes(0), lastChangedCells(0), totalBytes(0), frames(0) {}
+
+    void setDeltaMode(bool enabled) {
+        deltaMode = enabled;
+    }
+
+    bool getDeltaMode() const {
+        return deltaMode;
+    }
+
+    // Forces the next frame to be a full redraw
+    void invalidate() {
+        havePrevious = false;
+    }
+
+    // One line of text under the footer (stats), sent with full frames and with delta frames
+    // when it changed. Empty for none, setting it empty erases the line on the next frame.
+    void setOverlay(const std::string& line) {
+        if (line == overlay) return;
+        overlay = line;
+        overlayChanged = true;
+    }
+
+    // Footer is static text under the frame, only re-sent on full redraws
+    const std::string& encode(const FrameView& frame, bool useColor, const std::string& footer);
+
+    const std::string& encode(const FrameBuffer& frame, bool useColor, const std::string& footer) {
+        return encode(frame.view(), useColor, footer);
+    }
+
+    const std::string& getBuffer() const {
+        return out;
+    }
+
+    // Single write() of the encoded frame (looping only on short writes)
+    bool writeTo(int fd) const;
+
+    size_t getLastFrameBytes() const {
+        return lastBytes;
+    }
+
+    // Cells sent with the last frame, all of them for a full redraw
+    size_t getLastChangedCells() const {
+        return lastChangedCells;
+    }
+
+    double getAverageFrameBytes() const {
+        return frames ? static_cast<double>(totalBytes) / frames : 0.0;
+    }
+};
@@ -0,0 +1,45 @@
+#include "frame_scheduler.h"
+
+FrameScheduler::FrameScheduler(double fps)
+    : period(Clock::duration::zero()), frame(0), missedDeadlines(0), skippedFrames(0) {
+    setFps(fps);
+    reset();
+}
+
+void FrameScheduler::setFps(double fps) {
+    if (fps > 0.0) {
+        period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    } else {
+        period = Clock::duration::zero();
+    }
+}
+
+double FrameScheduler::getFps() const {
+    if (period == Clock::duration::zero()) return 0.0;
+    return 1.0 / std::chrono::duration<double>(period).count();
+}
+
+void FrameScheduler::reset(Clock::time_point now) {
+    start = now;
+    frame = 0;
+    missedDeadlines = 0;
+    skippedFrames = 0;
+}
+
+uint64_t FrameScheduler::beginFrame(Clock::time_point now) {
+    if (period == Clock::duration::zero() || now < start) return frame;
+    uint64_t due = static_cast<uint64_t>((now - start) / period);
+    if (due > frame) {
+        skippedFrames += due - frame;
+        frame = due;
+    }
+    return frame;
+}
+
+FrameScheduler::Clock::time_point FrameScheduler::endFrame(Clock::time_point now) {
+    frame++;
+    if (period == Clock::duration::zero()) return now;
+    Clock::time_point next = deadline(frame);
+    if (now > next) missedDeadlines++;
+    return next;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Paces the render loop on absolute steady_clock deadlines, frame n is due at start + n * period.
+// Sleeping to the next deadline instead of for a fixed time means render time doesn't add up,
+// and when a frame runs late the loop jumps ahead to the frame that is due now instead of
+// drifting further and further behind.
+class FrameScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    Clock::duration period;
+    Clock::time_point start;
+    uint64_t frame;
+    uint64_t missedDeadlines;
+    uint64_t skippedFrames;
+
+public:
+    // fps <= 0 doesn't pace at all
+    explicit FrameScheduler(double fps = 10.0);
+
+    void setFps(double fps);
+
+    double getFps() const;
+
+    // Starts the clock with frame 0 due at now
+    void reset(Clock::time_point now = Clock::now());
+
+    // Frame to produce at time now. Skips ahead (and counts it) when earlier frames are overdue.
+    uint64_t beginFrame(Clock::time_point now = Clock::now());
+
+    // Marks the current frame done at time now and returns when the next one should start.
+    // Finishing after the next frame was already due counts as a missed deadline.
+    Clock::time_point endFrame(Clock::time_point now = Clock::now());
+
+    Clock::time_point deadline(uint64_t n) const {
+        return start + period * static_cast<Clock::rep>(n);
+    }
+
+    uint64_t getMissedDeadlines() const {
+        return missedDeadlines;
+    }
+
+    uint64_t getSkippedFrames() const {
+        return skippedFrames;
+    }
+};
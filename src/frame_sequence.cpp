@@ -0,0 +1,242 @@
+#include "frame_sequence.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(FrameSequenceHeader) == 40, "header layout is part of the file format");
+static_assert(sizeof(ColorIndex) == 1, "color indices are stored as single bytes");
+
+static const char FRAME_SEQUENCE_MAGIC[8] = {'H', 'W', 'F', 'R', 'A', 'M', 'E', 'S'};
+
+// File byte order <-> host byte order, the same swap both ways
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+static uint32_t littleEndian(uint32_t v) {
+    return __builtin_bswap32(v);
+}
+
+static uint64_t littleEndian(uint64_t v) {
+    return __builtin_bswap64(v);
+}
+#else
+static uint32_t littleEndian(uint32_t v) {
+    return v;
+}
+
+static uint64_t littleEndian(uint64_t v) {
+    return v;
+}
+#endif
+
+static FrameSequenceHeader littleEndian(FrameSequenceHeader header) {
+    header.version = littleEndian(header.version);
+    header.flags = littleEndian(header.flags);
+    header.width = littleEndian(header.width);
+    header.height = littleEndian(header.height);
+    header.frameCount = littleEndian(header.frameCount);
+    header.fpsMilli = littleEndian(header.fpsMilli);
+    header.indexOffset = littleEndian(header.indexOffset);
+    return header;
+}
+
+FrameSequenceWriter::~FrameSequenceWriter() {
+    if (file) std::fclose(file);
+}
+
+void FrameSequenceWriter::writeBytes(const void* bytes, size_t count) {
+    if (ok && std::fwrite(bytes, 1, count, file) != count) ok = false;
+    position += count;
+}
+
+bool FrameSequenceWriter::open(const std::string& path, int width, int height, double fps, bool rle) {
+    if (file) std::fclose(file);
+    file = std::fopen(path.c_str(), "wb");
+    ok = file != nullptr && width > 0 && height > 0;
+    if (!ok) return false;
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, FRAME_SEQUENCE_MAGIC, sizeof(header.magic));
+    header.version = FRAME_SEQUENCE_VERSION;
+    header.flags = rle ? FRAME_SEQUENCE_RLE : 0;
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.fpsMilli = static_cast<uint32_t>(fps > 0.0 ? fps * 1000.0 + 0.5 : 0.0);
+    offsets.clear();
+    position = 0;
+    // Placeholder, the real one goes in once the index offset is known
+    FrameSequenceHeader stored = littleEndian(header);
+    writeBytes(&stored, sizeof(stored));
+    return ok;
+}
+
+bool FrameSequenceWriter::addFrame(const FrameView& frame) {
+    if (!ok || frame.width != static_cast<int>(header.width) || frame.height != static_cast<int>(header.height)) {
+        return false;
+    }
+    size_t cells = frame.cellCount();
+    offsets.push_back(position);
+    if (!(header.flags & FRAME_SEQUENCE_RLE)) {
+        writeBytes(frame.glyphs, cells);
+        writeBytes(frame.colors, cells);
+        header.frameCount++;
+        return ok;
+    }
+
+    scratch.clear();
+    size_t i = 0;
+    while (i < cells) {
+        size_t run = 1;
+        while (run < 256 && i + run < cells && frame.glyphs[i + run] == frame.glyphs[i] &&
+               frame.colors[i + run] == frame.colors[i]) {
+            run++;
+        }
+        scratch.push_back(static_cast<uint8_t>(run - 1));
+        scratch.push_back(static_cast<uint8_t>(frame.glyphs[i]));
+        scratch.push_back(static_cast<uint8_t>(frame.colors[i]));
+        i += run;
+    }
+    writeBytes(scratch.data(), scratch.size());
+    header.frameCount++;
+    return ok;
+}
+
+bool FrameSequenceWriter::finish() {
+    if (!file) return false;
+    offsets.push_back(position);
+    static const uint8_t padding[8] = {0};
+    writeBytes(padding, (8 - position % 8) % 8);
+    header.indexOffset = position;
+    for (uint64_t& offset : offsets) offset = littleEndian(offset);
+    writeBytes(offsets.data(), offsets.size() * sizeof(uint64_t));
+    FrameSequenceHeader stored = littleEndian(header);
+    if (ok) ok = std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&stored, sizeof(stored), 1, file) == 1;
+    if (std::fclose(file) != 0) ok = false;
+    file = nullptr;
+    return ok;
+}
+
+FrameSequence::~FrameSequence() {
+    close();
+}
+
+void FrameSequence::close() {
+    #ifdef _WIN32
+    contents.clear();
+    #else
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    #endif
+    data = nullptr;
+    size = 0;
+    offsets = nullptr;
+}
+
+bool FrameSequence::open(const std::string& path, std::string& error) {
+    close();
+    #ifdef _WIN32
+    // No mmap here, read it in once instead
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) contents.insert(contents.end(), chunk, chunk + n);
+    std::fclose(file);
+    data = contents.data();
+    size = contents.size();
+    #else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FrameSequenceHeader))) {
+        ::close(fd);
+        error = path + " is too small to be a frame sequence";
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "cannot map " + path;
+        return false;
+    }
+    data = static_cast<const uint8_t*>(mapping);
+    size = static_cast<size_t>(info.st_size);
+    madvise(mapping, size, MADV_WILLNEED);
+    #endif
+
+    if (size < sizeof(header)) {
+        error = path + " is too small to be a frame sequence";
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    header = littleEndian(header);
+    if (std::memcmp(header.magic, FRAME_SEQUENCE_MAGIC, sizeof(header.magic)) != 0) {
+        error = path + " is not a frame sequence";
+    } else if (header.version != FRAME_SEQUENCE_VERSION) {
+        error = path + " has unsupported version " + std::to_string(header.version);
+    } else if (header.width == 0 || header.height == 0 || header.width > 65535 || header.height > 65535) {
+        error = path + " has a bad frame size";
+    } else if (header.indexOffset % 8 != 0 || header.indexOffset > size ||
+               (size - header.indexOffset) / sizeof(uint64_t) < uint64_t(header.frameCount) + 1) {
+        error = path + " has a truncated index";
+    } else {
+        offsets = reinterpret_cast<const uint64_t*>(data + header.indexOffset);
+        for (uint32_t i = 0; i < header.frameCount; i++) {
+            if (offset(i) < sizeof(header) || offset(i) > offset(i + 1) || offset(i + 1) > header.indexOffset) {
+                error = path + " has a corrupt index";
+                close();
+                return false;
+            }
+        }
+        return true;
+    }
+    close();
+    return false;
+}
+
+uint64_t FrameSequence::offset(size_t i) const {
+    return littleEndian(offsets[i]);
+}
+
+bool FrameSequence::frame(int i, FrameBuffer& scratch, FrameView& view) const {
+    if (!data || i < 0 || i >= getFrameCount()) return false;
+    const uint8_t* begin = data + offset(i);
+    const uint8_t* end = data + offset(i + 1);
+    size_t cells = static_cast<size_t>(header.width) * header.height;
+
+    if (!isCompressed()) {
+        if (static_cast<size_t>(end - begin) != 2 * cells) return false;
+        view.width = getWidth();
+        view.height = getHeight();
+        view.glyphs = reinterpret_cast<const char*>(begin);
+        view.colors = reinterpret_cast<const ColorIndex*>(begin + cells);
+        view.backgroundKey = 0;
+        view.dirty.x0 = view.dirty.y0 = 0;
+        view.dirty.x1 = view.width;
+        view.dirty.y1 = view.height;
+        return true;
+    }
+
+    if (scratch.width != getWidth() || scratch.height != getHeight()) scratch.resize(getWidth(), getHeight());
+    size_t cell = 0;
+    for (const uint8_t* run = begin; run + 3 <= end; run += 3) {
+        size_t count = static_cast<size_t>(run[0]) + 1;
+        if (cell + count > cells) return false;
+        std::memset(&scratch.glyphs[cell], run[1], count);
+        std::memset(&scratch.colors[cell], run[2], count);
+        cell += count;
+    }
+    if (cell != cells || (end - begin) % 3 != 0) return false;
+    view = scratch.view();
+    return true;
+}
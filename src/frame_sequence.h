@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "frame_buffer.h"
+
+// Pre-rendered frame sequence file. Layout, all integers little endian:
+//
+//   FrameSequenceHeader
+//   frame 0 .. frame n-1     glyphs then color indices, raw (2 * width * height bytes) or RLE
+//   index                    n + 1 uint64 file offsets, 8 byte aligned, the last one is the end
+//                            of the frame data so frame i is [offset[i], offset[i + 1])
+//
+// RLE frames are runs of (count - 1, glyph, color) byte triples over the cells in row-major
+// order, runs never cross a frame but may cross rows.
+struct FrameSequenceHeader {
+    char magic[8];          // "HWFRAMES"
+    uint32_t version;
+    uint32_t flags;
+    uint32_t width;
+    uint32_t height;
+    uint32_t frameCount;
+    uint32_t fpsMilli;      // suggested playback rate * 1000
+    uint64_t indexOffset;
+};
+
+// On a little endian host the header and index are written as they are in memory and the index
+// is read straight out of the mapping. A big endian host byte swaps both on the way in and out.
+static_assert(sizeof(FrameSequenceHeader) == 40, "FrameSequenceHeader must have no padding");
+static_assert(offsetof(FrameSequenceHeader, indexOffset) == 32, "FrameSequenceHeader layout changed");
+
+constexpr uint32_t FRAME_SEQUENCE_VERSION = 1;
+constexpr uint32_t FRAME_SEQUENCE_RLE = 1;
+
+// Writes frames one at a time, the index and final header go out in finish()
+class FrameSequenceWriter {
+private:
+    std::FILE* file;
+    FrameSequenceHeader header;
+    std::vector<uint64_t> offsets;
+    std::vector<uint8_t> scratch;
+    uint64_t position;
+    bool ok;
+
+    void writeBytes(const void* data, size_t size);
+
+public:
+    FrameSequenceWriter() : file(nullptr), header(), position(0), ok(false) {}
+    ~FrameSequenceWriter();
+
+    FrameSequenceWriter(const FrameSequenceWriter&) = delete;
+    FrameSequenceWriter& operator=(const FrameSequenceWriter&) = delete;
+
+    bool open(const std::string& path, int width, int height, double fps, bool rle);
+
+    // Frame has to match the size given to open()
+    bool addFrame(const FrameView& frame);
+
+    bool finish();
+
+    // Bytes written so far
+    uint64_t getSize() const {
+        return position;
+    }
+};
+
+// Read side. The file is memory mapped; raw frames are handed out as views straight into the
+// mapping, RLE frames are expanded into a caller supplied buffer.
+class FrameSequence {
+private:
+    const uint8_t* data;
+    size_t size;
+    FrameSequenceHeader header;
+    const uint64_t* offsets;
+    #ifdef _WIN32
+    std::vector<uint8_t> contents;
+    #endif
+
+    void close();
+    uint64_t offset(size_t i) const;
+
+public:
+    FrameSequence() : data(nullptr), size(0), header(), offsets(nullptr) {}
+    ~FrameSequence();
+
+    FrameSequence(const FrameSequence&) = delete;
+    FrameSequence& operator=(const FrameSequence&) = delete;
+
+    // Maps and validates the header and index, error says what was wrong
+    bool open(const std::string& path, std::string& error);
+
+    int getWidth() const {
+        return static_cast<int>(header.width);
+    }
+
+    int getHeight() const {
+        return static_cast<int>(header.height);
+    }
+
+    int getFrameCount() const {
+        return static_cast<int>(header.frameCount);
+    }
+
+    double getFps() const {
+        return header.fpsMilli / 1000.0;
+    }
+
+    bool isCompressed() const {
+        return (header.flags & FRAME_SEQUENCE_RLE) != 0;
+    }
+
+    // Cells of frame i. Raw frames never touch scratch. False if the frame data is corrupt.
+    bool frame(int i, FrameBuffer& scratch, FrameView& view) const;
+};
@@ -0,0 +1,411 @@
+#include "frame_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Sent once to every new client before its first frame
+const std::shared_ptr<const std::string> CLEAR_SCREEN = std::make_shared<const std::string>("\033[2J");
+
+const int MIN_WIDTH = 10, MAX_WIDTH = 1000;
+const int MIN_HEIGHT = 5, MAX_HEIGHT = 500;
+
+#ifdef __linux__
+// "unix:/path" or "tcp:[host:]port" -> a socket address, false if it doesn't parse or resolve
+bool resolveAddress(const std::string& address, bool passive, sockaddr_storage& out, socklen_t& length,
+                    std::string& unixPath, std::string& error) {
+    std::memset(&out, 0, sizeof(out));
+    if (address.compare(0, 5, "unix:") == 0) {
+        unixPath = address.substr(5);
+        sockaddr_un* local = reinterpret_cast<sockaddr_un*>(&out);
+        if (unixPath.empty() || unixPath.size() >= sizeof(local->sun_path)) {
+            error = "bad socket path in " + address;
+            return false;
+        }
+        local->sun_family = AF_UNIX;
+        std::memcpy(local->sun_path, unixPath.c_str(), unixPath.size() + 1);
+        length = sizeof(sockaddr_un);
+        return true;
+    }
+    if (address.compare(0, 4, "tcp:") == 0) {
+        std::string rest = address.substr(4);
+        size_t colon = rest.rfind(':');
+        std::string host = colon == std::string::npos ? "" : rest.substr(0, colon);
+        std::string port = colon == std::string::npos ? rest : rest.substr(colon + 1);
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = passive ? AI_PASSIVE : 0;
+        addrinfo* result = nullptr;
+        int status = getaddrinfo(host.empty() ? (passive ? nullptr : "localhost") : host.c_str(), port.c_str(),
+                                 &hints, &result);
+        if (status != 0 || !result) {
+            error = "cannot resolve " + address + ": " + gai_strerror(status);
+            return false;
+        }
+        std::memcpy(&out, result->ai_addr, result->ai_addrlen);
+        length = result->ai_addrlen;
+        freeaddrinfo(result);
+        return true;
+    }
+    error = "address should be unix:/path or tcp:[host:]port, got " + address;
+    return false;
+}
+#endif
+
+}  // namespace
+
+FrameServer::FrameServer(Earth& earth, double fps, double rotationSpeed, bool useColor)
+    : listenFd(-1), epollFd(-1), earth(earth), scene(nullptr), scheduler(fps), rotationSpeed(rotationSpeed), useColor(useColor),
+      defaultWidth(150), defaultHeight(50), joinTimeout(std::chrono::seconds(5)), stopping(false),
+      stats{0, 0, 0, 0, 0, 0, 0} {}
+
+#ifdef __linux__
+
+FrameServer::~FrameServer() {
+    for (auto& entry : clients) ::close(entry.first);
+    if (listenFd >= 0) ::close(listenFd);
+    if (epollFd >= 0) ::close(epollFd);
+    if (!unixPath.empty()) ::unlink(unixPath.c_str());
+}
+
+bool FrameServer::listen(const std::string& address, std::string& error) {
+    sockaddr_storage storage;
+    socklen_t length = 0;
+    std::string path;
+    if (!resolveAddress(address, true, storage, length, path, error)) return false;
+
+    listenFd = ::socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    if (storage.ss_family == AF_UNIX) {
+        // A stale socket file from an earlier run would make bind fail
+        ::unlink(path.c_str());
+    } else {
+        int on = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&storage), length) != 0 || ::listen(listenFd, 128) != 0) {
+        error = "cannot listen on " + address + ": " + std::strerror(errno);
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    unixPath = path;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    if (epollFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0) {
+        error = std::string("epoll: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void FrameServer::acceptClients() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;  // EAGAIN, or out of descriptors and we'll retry on the next wakeup
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));  // fails harmlessly on Unix sockets
+
+        // Edge triggered: reads and writes go until EAGAIN, then wait for the next edge
+        epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        Client client;
+        client.fd = fd;
+        client.accepted = FrameScheduler::Clock::now();
+        client.joined = false;
+        client.offset = 0;
+        client.sendingId = 0;
+        clients[fd] = client;
+        stats.clientsAccepted++;
+    }
+}
+
+void FrameServer::readClient(Client& client) {
+    char buffer[256];
+    while (true) {
+        ssize_t n = ::recv(client.fd, buffer, sizeof(buffer), 0);
+        if (n == 0) {
+            dropClient(client.fd);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) dropClient(client.fd);
+            return;
+        }
+        if (client.joined) continue;  // nothing else to say after the size line
+
+        client.hello.append(buffer, n);
+        size_t newline = client.hello.find('\n');
+        if (newline == std::string::npos) {
+            if (client.hello.size() > 64) {
+                dropClient(client.fd);
+                return;
+            }
+            continue;
+        }
+        int width = defaultWidth, height = defaultHeight;
+        if (newline > 0) std::sscanf(client.hello.c_str(), "%dx%d", &width, &height);
+        int fd = client.fd;
+        join(client, width, height);
+        // join may already have dropped it, otherwise keep draining so a hangup queued behind the
+        // size line is seen now and not on an edge that never comes
+        if (clients.find(fd) == clients.end()) return;
+    }
+}
+
+void FrameServer::join(Client& client, int width, int height) {
+    width = std::max(MIN_WIDTH, std::min(MAX_WIDTH, width));
+    height = std::max(MIN_HEIGHT, std::min(MAX_HEIGHT, height));
+    client.size = std::make_pair(width, height);
+    client.joined = true;
+    client.hello.clear();
+
+    Group& group = groups[client.size];
+    if (!group.renderer) {
+        group.renderer.reset(new ASCIIRenderer(width, height, useColor));
+        if (configure) configure(*group.renderer);
+        // Every client gets whole frames, deltas only work for someone who saw the last one
+        group.renderer->setDeltaOutput(false);
+        group.latestId = 0;
+        group.clients = 0;
+    }
+    group.clients++;
+
+    client.sending = CLEAR_SCREEN;
+    client.offset = 0;
+    client.sendingId = 0;
+    flush(client);
+}
+
+void FrameServer::flush(Client& client) {
+    while (client.sending) {
+        const std::string& data = *client.sending;
+        while (client.offset < data.size()) {
+            ssize_t n = ::send(client.fd, data.data() + client.offset, data.size() - client.offset,
+                               MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) dropClient(client.fd);
+                return;  // the next EPOLLOUT edge picks it up again
+            }
+            client.offset += static_cast<size_t>(n);
+            stats.bytesSent += static_cast<uint64_t>(n);
+        }
+        if (client.sending != CLEAR_SCREEN) stats.framesSent++;
+
+        // Done with that one, go straight to the newest frame and skip whatever came in between
+        const Group& group = groups[client.size];
+        if (group.latest && group.latestId != client.sendingId) {
+            if (client.sendingId != 0) stats.framesSkipped += group.latestId - client.sendingId - 1;
+            client.sending = group.latest;
+            client.sendingId = group.latestId;
+            client.offset = 0;
+        } else {
+            client.sending.reset();
+        }
+    }
+}
+
+void FrameServer::dropClient(int fd) {
+    auto found = clients.find(fd);
+    if (found == clients.end()) return;
+    if (found->second.joined) {
+        auto group = groups.find(found->second.size);
+        if (group != groups.end() && --group->second.clients == 0) groups.erase(group);
+    }
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    clients.erase(found);
+}
+
+void FrameServer::dropUnjoinedClients(FrameScheduler::Clock::time_point now) {
+    std::vector<int> stalled;
+    for (auto& entry : clients) {
+        if (!entry.second.joined && now - entry.second.accepted >= joinTimeout) stalled.push_back(entry.first);
+    }
+    for (int fd : stalled) {
+        dropClient(fd);
+        stats.clientsTimedOut++;
+    }
+}
+
+void FrameServer::renderGroups(uint64_t frame) {
+    double angle = std::fmod(frame * rotationSpeed, 2.0 * PI);
+    if (scene) {
+        scene->animate(angle);
+    } else {
+        earth.rotationY = angle;
+    }
+    for (auto& entry : groups) {
+        Group& group = entry.second;
+        if (scene) {
+            group.renderer->render(*scene);
+        } else {
+            group.renderer->render(earth);
+        }
+        // One encode per group, every client of that size shares this buffer
+        group.latest = std::make_shared<const std::string>(group.renderer->encodeFrame());
+        group.latestId++;
+        stats.renders++;
+    }
+
+    // Idle clients start on the new frame right away, busy ones switch when they finish theirs
+    std::vector<int> idle;
+    for (auto& entry : clients) {
+        if (entry.second.joined && !entry.second.sending) idle.push_back(entry.first);
+    }
+    for (int fd : idle) {
+        auto found = clients.find(fd);
+        if (found == clients.end()) continue;
+        Client& client = found->second;
+        const Group& group = groups[client.size];
+        client.sending = group.latest;
+        client.sendingId = group.latestId;
+        client.offset = 0;
+        flush(client);
+    }
+}
+
+void FrameServer::pollUntil(FrameScheduler::Clock::time_point deadline) {
+    epoll_event events[64];
+    do {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - FrameScheduler::Clock::now());
+        int timeout = static_cast<int>(std::max<long long>(0, left.count()));
+        int count = epoll_wait(epollFd, events, 64, timeout);
+        if (count < 0 && errno != EINTR) return;
+        for (int e = 0; e < count; e++) {
+            int fd = events[e].data.fd;
+            if (fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+            if (events[e].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                auto found = clients.find(fd);
+                if (found != clients.end()) readClient(found->second);
+            }
+            if (events[e].events & EPOLLOUT) {
+                auto found = clients.find(fd);
+                if (found != clients.end()) flush(found->second);
+            }
+        }
+        dropUnjoinedClients(FrameScheduler::Clock::now());
+    } while (!stopping.load() && FrameScheduler::Clock::now() < deadline);
+}
+
+void FrameServer::run(uint64_t maxFrames) {
+    if (epollFd < 0) return;
+    scheduler.reset();
+    for (uint64_t count = 0; !stopping.load() && (maxFrames == 0 || count < maxFrames); count++) {
+        uint64_t frame = scheduler.beginFrame();
+        if (!groups.empty()) renderGroups(frame);
+        stats.frames++;
+        pollUntil(scheduler.endFrame());
+    }
+}
+
+int connectSocket(const std::string& address, std::string& error) {
+    sockaddr_storage storage;
+    socklen_t length = 0;
+    std::string path;
+    if (!resolveAddress(address, false, storage, length, path, error)) return -1;
+    int fd = ::socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&storage), length) != 0) {
+        error = "cannot connect to " + address + ": " + std::strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+long runFrameClient(const std::string& address, int width, int height, int outFd, long maxBytes) {
+    std::string error;
+    int fd = connectSocket(address, error);
+    if (fd < 0) return -1;
+
+    char hello[32];
+    int n = std::snprintf(hello, sizeof(hello), "%dx%d\n", width, height);
+    if (::send(fd, hello, n, MSG_NOSIGNAL) != n) {
+        ::close(fd);
+        return -1;
+    }
+
+    long received = 0;
+    char buffer[65536];
+    while (maxBytes == 0 || received < maxBytes) {
+        ssize_t got = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        received += got;
+        for (ssize_t done = 0; done < got && outFd >= 0;) {
+            ssize_t written = ::write(outFd, buffer + done, got - done);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                outFd = -1;  // keep draining the socket, just stop copying
+                break;
+            }
+            done += written;
+        }
+    }
+    ::close(fd);
+    return received;
+}
+
+#else
+
+FrameServer::~FrameServer() {}
+
+bool FrameServer::listen(const std::string&, std::string& error) {
+    error = "the frame server needs epoll, it's Linux only";
+    return false;
+}
+
+void FrameServer::run(uint64_t) {}
+
+int connectSocket(const std::string&, std::string& error) {
+    error = "sockets are only supported on Linux";
+    return -1;
+}
+
+long runFrameClient(const std::string&, int, int, int, long) {
+    return -1;
+}
+
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ascii_renderer.h"
+#include "earth.h"
+#include "frame_scheduler.h"
+#include "scene.h"
+
+// Serves the globe to many terminals at once. Clients connect over a Unix-domain or TCP socket
+// and send their size as one line ("80x24\n", an empty line takes the default). Clients of the
+// same size share a group with one renderer, so every frame is rendered and encoded once per
+// size and the same immutable buffer is written to every client in the group. Sockets are
+// non-blocking and driven by epoll; a client that can't keep up finishes the frame it is on
+// and then skips straight to the newest one. A client that hasn't sent its size line within the
+// join timeout is dropped, so silent connections can't pile up.
+//
+// Addresses are "unix:/path/to/socket" or "tcp:[host:]port". Linux only (epoll).
+class FrameServer {
+public:
+    struct Stats {
+        uint64_t frames;         // ticks of the scheduler
+        uint64_t renders;        // frames rendered, summed over groups
+        uint64_t framesSent;     // complete frames written, summed over clients
+        uint64_t framesSkipped;  // frames slow clients never got
+        uint64_t bytesSent;
+        uint64_t clientsAccepted;
+        uint64_t clientsTimedOut;  // dropped for never sending their size line
+    };
+
+    // Called on every new group's renderer, for threads/SIMD/cache and so on
+    typedef std::function<void(ASCIIRenderer&)> Configure;
+
+private:
+    typedef std::shared_ptr<const std::string> Frame;
+
+    struct Group {
+        std::unique_ptr<ASCIIRenderer> renderer;
+        Frame latest;
+        uint64_t latestId;
+        int clients;
+    };
+
+    struct Client {
+        int fd;
+        std::string hello;  // size line until it's complete
+        FrameScheduler::Clock::time_point accepted;
+        std::pair<int, int> size;
+        bool joined;
+        Frame sending;
+        size_t offset;
+        uint64_t sendingId;
+    };
+
+    int listenFd;
+    int epollFd;
+    std::string unixPath;
+    std::map<int, Client> clients;
+    std::map<std::pair<int, int>, Group> groups;
+    Earth& earth;
+    Scene* scene;
+    FrameScheduler scheduler;
+    double rotationSpeed;
+    bool useColor;
+    int defaultWidth, defaultHeight;
+    FrameScheduler::Clock::duration joinTimeout;
+    Configure configure;
+    std::atomic<bool> stopping;
+    Stats stats;
+
+    void acceptClients();
+    void readClient(Client& client);
+    void join(Client& client, int width, int height);
+    void flush(Client& client);
+    void dropClient(int fd);
+    void dropUnjoinedClients(FrameScheduler::Clock::time_point now);
+    void renderGroups(uint64_t frame);
+    void pollUntil(FrameScheduler::Clock::time_point deadline);
+
+public:
+    FrameServer(Earth& earth, double fps, double rotationSpeed, bool useColor = true);
+    ~FrameServer();
+
+    FrameServer(const FrameServer&) = delete;
+    FrameServer& operator=(const FrameServer&) = delete;
+
+    void setDefaultSize(int width, int height) {
+        defaultWidth = width;
+        defaultHeight = height;
+    }
+
+    // How long a new client has to send its size line (5 seconds by default)
+    void setJoinTimeout(double seconds) {
+        joinTimeout = std::chrono::duration_cast<FrameScheduler::Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    void setConfigure(const Configure& callback) {
+        configure = callback;
+    }
+
+    // Serve a whole scene instead of the globe, animated once per tick and rendered per group
+    void setScene(Scene* s) {
+        scene = s;
+    }
+
+    // Binds and starts listening, error says why not
+    bool listen(const std::string& address, std::string& error);
+
+    // Serves maxFrames frames (0 = until stop())
+    void run(uint64_t maxFrames = 0);
+
+    // Safe from other threads and signal handlers
+    void stop() {
+        stopping.store(true);
+    }
+
+    int getClientCount() const {
+        return static_cast<int>(clients.size());
+    }
+
+    int getGroupCount() const {
+        return static_cast<int>(groups.size());
+    }
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
+
+// Connected stream socket for "unix:/path" or "tcp:[host:]port", -1 with error set otherwise
+int connectSocket(const std::string& address, std::string& error);
+
+// Local stand-in for a terminal: connects, announces width x height and copies whatever the
+// server sends to outFd until the server hangs up or maxBytes have arrived (0 = no limit).
+// Returns the number of bytes received, -1 if it couldn't connect.
+long runFrameClient(const std::string& address, int width, int height, int outFd, long maxBytes = 0);
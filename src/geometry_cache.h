@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "camera.h"
+#include "earth.h"
+
+// Per-pixel ray/sphere results for a fixed camera, viewport and globe placement. Spinning the
+// globe doesn't move any of it, so it's only rebuilt when one of those changes.
+struct GeometryCache {
+    struct Hit {
+        int index;
+        double depth;
+        Vec3 hitPoint;
+        Vec3 normal;
+        double lat, lon;  // unspun, see Earth::baseLatLon
+        double footprint;  // see ASCIIRenderer::surfaceFootprint
+    };
+
+    // What the cached geometry depends on
+    struct Key {
+        double values[17];
+
+        bool operator==(const Key& other) const {
+            return std::equal(values, values + 17, other.values);
+        }
+    };
+
+    bool valid;
+    Key key;
+    std::vector<std::vector<Hit>> tiles;  // hits grouped by render tile
+
+    GeometryCache() : valid(false) {}
+
+    static Key makeKey(const Camera& camera, const Earth& earth, int width, int height) {
+        Key key = {{camera.position.x, camera.position.y, camera.position.z,
+                    camera.lookAt.x, camera.lookAt.y, camera.lookAt.z,
+                    camera.up.x, camera.up.y, camera.up.z,
+                    camera.fov, camera.aspectRatio,
+                    earth.position.x, earth.position.y, earth.position.z, earth.radius,
+                    static_cast<double>(width), static_cast<double>(height)}};
+        return key;
+    }
+};
@@ -0,0 +1,37 @@
+#include "land_texture.h"
+
+constexpr int LandTexture::MAX_RESOLUTION;
+
+void LandTexture::initLevel(Level& level, int latRes, int lonRes) {
+    level.latRes = latRes;
+    level.lonRes = lonRes;
+    level.wordsPerRow = (lonRes + 63) / 64;
+    level.latScale = latRes / 180.0;
+    level.lonScale = lonRes / 360.0;
+    level.bits.assign(static_cast<size_t>(latRes) * level.wordsPerRow, 0);
+}
+
+void LandTexture::resize(int latRes, int lonRes) {
+    levels.resize(1);
+    initLevel(levels[0], std::max(1, std::min(MAX_RESOLUTION, latRes)),
+              std::max(1, std::min(MAX_RESOLUTION, lonRes)));
+}
+
+void LandTexture::buildMips() {
+    levels.resize(1);
+    while (levels.back().latRes > 1 && levels.back().lonRes > 1) {
+        Level next;
+        const Level& prev = levels.back();
+        initLevel(next, (prev.latRes + 1) / 2, (prev.lonRes + 1) / 2);
+        for (int lat = 0; lat < next.latRes; lat++) {
+            int lat0 = 2 * lat, lat1 = std::min(2 * lat + 1, prev.latRes - 1);
+            for (int lon = 0; lon < next.lonRes; lon++) {
+                int lon0 = 2 * lon, lon1 = std::min(2 * lon + 1, prev.lonRes - 1);
+                int count = getBit(prev, lat0, lon0) + getBit(prev, lat0, lon1)
+                          + getBit(prev, lat1, lon0) + getBit(prev, lat1, lon1);
+                if (count >= 2) next.bits[lat * next.wordsPerRow + (lon >> 6)] |= uint64_t(1) << (lon & 63);
+            }
+        }
+        levels.push_back(std::move(next));
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "fixed_point.h"
+#include "vec3.h"
+
+// Texels per radian of one mip level in whatever scalar a render path shades in, converted
+// once per frame so lookups from float or fixed point coordinates never go through double
+template <typename T>
+struct TexelScale {
+    T lat, lon;
+};
+
+// Texel index from an offset angle, truncated like the double lookup
+template <typename T>
+inline int texelIndex(T radians, T texelsPerRadian) {
+    return static_cast<int>(radians * texelsPerRadian);
+}
+
+// Q16.16 can't hold the product on big textures (it tops out at 32767 texels), so take the
+// integer part of the full 64-bit product instead. Negative angles floor to -1, which the
+// caller's clamp turns into 0 just like truncation would.
+inline int texelIndex(Fixed radians, Fixed texelsPerRadian) {
+    int64_t product = static_cast<int64_t>(radians.getRaw()) * texelsPerRadian.getRaw();
+    return static_cast<int>(product >> (2 * Fixed::FRACTION_BITS));
+}
+
+// Land/ocean mask, one bit per texel, plus mip levels where each texel is land if at least
+// half of the 2x2 block under it is. Row 0 is the south pole, column 0 is longitude -180.
+class LandTexture {
+private:
+    struct Level {
+        int latRes, lonRes;
+        int wordsPerRow;
+        double latScale, lonScale;  // texels per degree
+        std::vector<uint64_t> bits;
+    };
+
+    std::vector<Level> levels;
+
+    static void initLevel(Level& level, int latRes, int lonRes);
+
+    static bool getBit(const Level& level, int latIdx, int lonIdx) {
+        return (level.bits[latIdx * level.wordsPerRow + (lonIdx >> 6)] >> (lonIdx & 63)) & 1;
+    }
+
+public:
+    // Largest resolution each way, resize() clamps to it. Keeps texels per radian within what
+    // Fixed holds, so the fixed point lookups work at every size.
+    static constexpr int MAX_RESOLUTION = 65536;
+
+    LandTexture(int latRes = 180, int lonRes = 360) {
+        resize(latRes, lonRes);
+    }
+
+    // Clears to ocean and drops the mips, sizes are clamped to [1, MAX_RESOLUTION]
+    void resize(int latRes, int lonRes);
+
+    int getLatRes() const {
+        return levels[0].latRes;
+    }
+
+    int getLonRes() const {
+        return levels[0].lonRes;
+    }
+
+    int getLevelCount() const {
+        return static_cast<int>(levels.size());
+    }
+
+    bool get(int latIdx, int lonIdx) const {
+        return getBit(levels[0], latIdx, lonIdx);
+    }
+
+    void set(int latIdx, int lonIdx, bool land) {
+        Level& level = levels[0];
+        uint64_t& word = level.bits[latIdx * level.wordsPerRow + (lonIdx >> 6)];
+        uint64_t mask = uint64_t(1) << (lonIdx & 63);
+        word = land ? (word | mask) : (word & ~mask);
+    }
+
+    // Call after editing level 0
+    void buildMips();
+
+    // lat/lon in degrees, level is clamped to what exists. No branches on the data path,
+    // the clamps compile to min/max.
+    bool isLand(double lat, double lon, int level = 0) const {
+        const Level& l = levels[std::max(0, std::min(getLevelCount() - 1, level))];
+        int latIdx = static_cast<int>((lat + 90.0) * l.latScale);
+        int lonIdx = static_cast<int>((lon + 180.0) * l.lonScale);
+        latIdx = std::max(0, std::min(l.latRes - 1, latIdx));
+        lonIdx = std::max(0, std::min(l.lonRes - 1, lonIdx));
+        return getBit(l, latIdx, lonIdx);
+    }
+
+    // Texels per radian at a level, clamped like isLand
+    template <typename T>
+    TexelScale<T> texelScale(int level) const {
+        const Level& l = levels[std::max(0, std::min(getLevelCount() - 1, level))];
+        TexelScale<T> scale = {static_cast<T>(l.latScale * 180.0 / PI), static_cast<T>(l.lonScale * 180.0 / PI)};
+        return scale;
+    }
+
+    // Same lookup from radians in T with that level's texelScale. Level must be one that exists.
+    template <typename T>
+    bool isLandRad(T latRad, T lonRad, const TexelScale<T>& scale, int level) const {
+        const Level& l = levels[level];
+        int latIdx = texelIndex(latRad + T(PI / 2.0), scale.lat);
+        int lonIdx = texelIndex(lonRad + T(PI), scale.lon);
+        latIdx = std::max(0, std::min(l.latRes - 1, latIdx));
+        lonIdx = std::max(0, std::min(l.lonRes - 1, lonIdx));
+        return getBit(l, latIdx, lonIdx);
+    }
+};
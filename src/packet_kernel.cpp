@@ -0,0 +1,236 @@
+#include "packet_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HW_HAVE_X86_SIMD 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HW_TARGET_AVX2
+#endif
+
+void tracePacketScalar(const PacketScene& scene, const float* screenX, const float* screenY, int count,
+                       HitPacket& out) {
+    float ocX = scene.origin[0] - scene.center[0];
+    float ocY = scene.origin[1] - scene.center[1];
+    float ocZ = scene.origin[2] - scene.center[2];
+    float c = ocX * ocX + ocY * ocY + ocZ * ocZ - scene.radius * scene.radius;
+
+    for (int lane = 0; lane < count; lane++) {
+        float sx = screenX[lane] * scene.widthAtDist1;
+        float sy = screenY[lane] * scene.heightAtDist1;
+        float dx = scene.forward[0] + scene.right[0] * sx + scene.up[0] * sy;
+        float dy = scene.forward[1] + scene.right[1] * sx + scene.up[1] * sy;
+        float dz = scene.forward[2] + scene.right[2] * sx + scene.up[2] * sy;
+        float invLen = 1.0f / std::sqrt(dx * dx + dy * dy + dz * dz);
+        dx *= invLen;
+        dy *= invLen;
+        dz *= invLen;
+
+        float a = dx * dx + dy * dy + dz * dz;
+        float b = 2.0f * (ocX * dx + ocY * dy + ocZ * dz);
+        float discriminant = b * b - 4.0f * a * c;
+        float root = std::sqrt(std::max(discriminant, 0.0f));
+        float inv2a = 0.5f / a;
+        float t1 = (-b - root) * inv2a;
+        float t2 = (-b + root) * inv2a;
+        // t1 <= t2, so the nearest non-negative root is t1 unless we're inside the sphere
+        float t = (t1 >= 0.0f) ? t1 : t2;
+        bool hit = discriminant >= 0.0f && t >= 0.0f;
+
+        float px = scene.origin[0] + dx * t;
+        float py = scene.origin[1] + dy * t;
+        float pz = scene.origin[2] + dz * t;
+        float nx = px - scene.center[0];
+        float ny = py - scene.center[1];
+        float nz = pz - scene.center[2];
+        float invN = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+        nx *= invN;
+        ny *= invN;
+        nz *= invN;
+
+        out.depth[lane] = t;
+        out.pointX[lane] = px;
+        out.pointY[lane] = py;
+        out.pointZ[lane] = pz;
+        out.normalX[lane] = nx;
+        out.normalY[lane] = ny;
+        out.normalZ[lane] = nz;
+        out.diffuse[lane] = std::max(0.0f, nx * scene.light[0] + ny * scene.light[1] + nz * scene.light[2]);
+        out.hit[lane] = hit ? -1 : 0;
+    }
+}
+
+#ifdef HW_HAVE_X86_SIMD
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Lanes [first, count) in steps of 4, also the tail of the AVX2 kernel
+static void tracePacketSSELanes(const PacketScene& scene, const float* screenX, const float* screenY, int first,
+                                int count, HitPacket& out) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    float ocXs = scene.origin[0] - scene.center[0];
+    float ocYs = scene.origin[1] - scene.center[1];
+    float ocZs = scene.origin[2] - scene.center[2];
+    const __m128 ocX = _mm_set1_ps(ocXs);
+    const __m128 ocY = _mm_set1_ps(ocYs);
+    const __m128 ocZ = _mm_set1_ps(ocZs);
+    const __m128 c = _mm_set1_ps(ocXs * ocXs + ocYs * ocYs + ocZs * ocZs - scene.radius * scene.radius);
+
+    for (int lane = first; lane < count; lane += 4) {
+        __m128 sx = _mm_mul_ps(_mm_loadu_ps(screenX + lane), _mm_set1_ps(scene.widthAtDist1));
+        __m128 sy = _mm_mul_ps(_mm_loadu_ps(screenY + lane), _mm_set1_ps(scene.heightAtDist1));
+        __m128 dx = _mm_add_ps(_mm_add_ps(_mm_set1_ps(scene.forward[0]), _mm_mul_ps(_mm_set1_ps(scene.right[0]), sx)), _mm_mul_ps(_mm_set1_ps(scene.up[0]), sy));
+        __m128 dy = _mm_add_ps(_mm_add_ps(_mm_set1_ps(scene.forward[1]), _mm_mul_ps(_mm_set1_ps(scene.right[1]), sx)), _mm_mul_ps(_mm_set1_ps(scene.up[1]), sy));
+        __m128 dz = _mm_add_ps(_mm_add_ps(_mm_set1_ps(scene.forward[2]), _mm_mul_ps(_mm_set1_ps(scene.right[2]), sx)), _mm_mul_ps(_mm_set1_ps(scene.up[2]), sy));
+        __m128 invLen = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz))));
+        dx = _mm_mul_ps(dx, invLen);
+        dy = _mm_mul_ps(dy, invLen);
+        dz = _mm_mul_ps(dz, invLen);
+
+        __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 b = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocX, dx), _mm_mul_ps(ocY, dy)), _mm_mul_ps(ocZ, dz)));
+        __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_set1_ps(4.0f), _mm_mul_ps(a, c)));
+        __m128 root = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+        __m128 inv2a = _mm_div_ps(_mm_set1_ps(0.5f), a);
+        __m128 negB = _mm_sub_ps(zero, b);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(negB, root), inv2a);
+        __m128 t2 = _mm_mul_ps(_mm_add_ps(negB, root), inv2a);
+        __m128 t = select4(_mm_cmpge_ps(t1, zero), t1, t2);
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(discriminant, zero), _mm_cmpge_ps(t, zero));
+
+        __m128 px = _mm_add_ps(_mm_set1_ps(scene.origin[0]), _mm_mul_ps(dx, t));
+        __m128 py = _mm_add_ps(_mm_set1_ps(scene.origin[1]), _mm_mul_ps(dy, t));
+        __m128 pz = _mm_add_ps(_mm_set1_ps(scene.origin[2]), _mm_mul_ps(dz, t));
+        __m128 nx = _mm_sub_ps(px, _mm_set1_ps(scene.center[0]));
+        __m128 ny = _mm_sub_ps(py, _mm_set1_ps(scene.center[1]));
+        __m128 nz = _mm_sub_ps(pz, _mm_set1_ps(scene.center[2]));
+        __m128 invN = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz))));
+        nx = _mm_mul_ps(nx, invN);
+        ny = _mm_mul_ps(ny, invN);
+        nz = _mm_mul_ps(nz, invN);
+        __m128 diffuse = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(scene.light[0])), _mm_mul_ps(ny, _mm_set1_ps(scene.light[1]))), _mm_mul_ps(nz, _mm_set1_ps(scene.light[2])));
+
+        _mm_storeu_ps(out.depth + lane, t);
+        _mm_storeu_ps(out.pointX + lane, px);
+        _mm_storeu_ps(out.pointY + lane, py);
+        _mm_storeu_ps(out.pointZ + lane, pz);
+        _mm_storeu_ps(out.normalX + lane, nx);
+        _mm_storeu_ps(out.normalY + lane, ny);
+        _mm_storeu_ps(out.normalZ + lane, nz);
+        _mm_storeu_ps(out.diffuse + lane, _mm_max_ps(zero, diffuse));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out.hit + lane), _mm_castps_si128(hit));
+    }
+}
+
+static void tracePacketSSE(const PacketScene& scene, const float* screenX, const float* screenY, int count,
+                           HitPacket& out) {
+    tracePacketSSELanes(scene, screenX, screenY, 0, count, out);
+}
+
+HW_TARGET_AVX2 static void tracePacketAVX2(const PacketScene& scene, const float* screenX, const float* screenY,
+                                           int count, HitPacket& out) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    float ocXs = scene.origin[0] - scene.center[0];
+    float ocYs = scene.origin[1] - scene.center[1];
+    float ocZs = scene.origin[2] - scene.center[2];
+    const __m256 ocX = _mm256_set1_ps(ocXs);
+    const __m256 ocY = _mm256_set1_ps(ocYs);
+    const __m256 ocZ = _mm256_set1_ps(ocZs);
+    const __m256 c = _mm256_set1_ps(ocXs * ocXs + ocYs * ocYs + ocZs * ocZs - scene.radius * scene.radius);
+
+    int lane = 0;
+    for (; lane + 8 <= count; lane += 8) {
+        __m256 sx = _mm256_mul_ps(_mm256_loadu_ps(screenX + lane), _mm256_set1_ps(scene.widthAtDist1));
+        __m256 sy = _mm256_mul_ps(_mm256_loadu_ps(screenY + lane), _mm256_set1_ps(scene.heightAtDist1));
+        __m256 dx = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(scene.forward[0]), _mm256_mul_ps(_mm256_set1_ps(scene.right[0]), sx)), _mm256_mul_ps(_mm256_set1_ps(scene.up[0]), sy));
+        __m256 dy = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(scene.forward[1]), _mm256_mul_ps(_mm256_set1_ps(scene.right[1]), sx)), _mm256_mul_ps(_mm256_set1_ps(scene.up[1]), sy));
+        __m256 dz = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(scene.forward[2]), _mm256_mul_ps(_mm256_set1_ps(scene.right[2]), sx)), _mm256_mul_ps(_mm256_set1_ps(scene.up[2]), sy));
+        __m256 invLen = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz))));
+        dx = _mm256_mul_ps(dx, invLen);
+        dy = _mm256_mul_ps(dy, invLen);
+        dz = _mm256_mul_ps(dz, invLen);
+
+        __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        __m256 b = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocX, dx), _mm256_mul_ps(ocY, dy)), _mm256_mul_ps(ocZ, dz)));
+        __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(_mm256_set1_ps(4.0f), _mm256_mul_ps(a, c)));
+        __m256 root = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+        __m256 inv2a = _mm256_div_ps(_mm256_set1_ps(0.5f), a);
+        __m256 negB = _mm256_sub_ps(zero, b);
+        __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(negB, root), inv2a);
+        __m256 t2 = _mm256_mul_ps(_mm256_add_ps(negB, root), inv2a);
+        __m256 t = _mm256_blendv_ps(t2, t1, _mm256_cmp_ps(t1, zero, _CMP_GE_OQ));
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+
+        __m256 px = _mm256_add_ps(_mm256_set1_ps(scene.origin[0]), _mm256_mul_ps(dx, t));
+        __m256 py = _mm256_add_ps(_mm256_set1_ps(scene.origin[1]), _mm256_mul_ps(dy, t));
+        __m256 pz = _mm256_add_ps(_mm256_set1_ps(scene.origin[2]), _mm256_mul_ps(dz, t));
+        __m256 nx = _mm256_sub_ps(px, _mm256_set1_ps(scene.center[0]));
+        __m256 ny = _mm256_sub_ps(py, _mm256_set1_ps(scene.center[1]));
+        __m256 nz = _mm256_sub_ps(pz, _mm256_set1_ps(scene.center[2]));
+        __m256 invN = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), _mm256_mul_ps(nz, nz))));
+        nx = _mm256_mul_ps(nx, invN);
+        ny = _mm256_mul_ps(ny, invN);
+        nz = _mm256_mul_ps(nz, invN);
+        __m256 diffuse = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, _mm256_set1_ps(scene.light[0])), _mm256_mul_ps(ny, _mm256_set1_ps(scene.light[1]))), _mm256_mul_ps(nz, _mm256_set1_ps(scene.light[2])));
+
+        _mm256_storeu_ps(out.depth + lane, t);
+        _mm256_storeu_ps(out.pointX + lane, px);
+        _mm256_storeu_ps(out.pointY + lane, py);
+        _mm256_storeu_ps(out.pointZ + lane, pz);
+        _mm256_storeu_ps(out.normalX + lane, nx);
+        _mm256_storeu_ps(out.normalY + lane, ny);
+        _mm256_storeu_ps(out.normalZ + lane, nz);
+        _mm256_storeu_ps(out.diffuse + lane, _mm256_max_ps(zero, diffuse));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.hit + lane), _mm256_castps_si256(hit));
+    }
+    // A 4 ray packet (or the odd half of one) doesn't fill a 256-bit register
+    if (lane < count) tracePacketSSELanes(scene, screenX, screenY, lane, count, out);
+}
+#endif
+
+PacketIsa detectPacketIsa() {
+#ifdef HW_HAVE_X86_SIMD
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && ((_xgetbv(0) & 6) == 6);
+    __cpuidex(info, 7, 0);
+    if (osSavesYmm && (info[1] & (1 << 5))) return PacketIsa::AVX2;
+#else
+    if (__builtin_cpu_supports("avx2")) return PacketIsa::AVX2;
+#endif
+    return PacketIsa::SSE;
+#else
+    return PacketIsa::Scalar;
+#endif
+}
+
+PacketKernel getPacketKernel(PacketIsa isa) {
+#ifdef HW_HAVE_X86_SIMD
+    if (isa == PacketIsa::AVX2) return tracePacketAVX2;
+    if (isa == PacketIsa::SSE) return tracePacketSSE;
+#else
+    (void)isa;
+#endif
+    return tracePacketScalar;
+}
+
+const char* packetIsaName(PacketIsa isa) {
+    switch (isa) {
+        case PacketIsa::AVX2: return "avx2";
+        case PacketIsa::SSE: return "sse";
+        default: return "scalar";
+    }
+}
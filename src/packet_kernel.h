@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+// Packet ray tracing. A packet of 4, 8 or 16 rays goes through generation, the ray-sphere test,
+// hit point, normal and diffuse lighting together in float SoA form, 8 lanes at a time on AVX2
+// (a 4 ray tail with SSE), 4 on SSE, 1 on the scalar fallback. PACKET_SIZE is the widest packet,
+// what the buffers are sized for.
+constexpr int PACKET_SIZE = 16;
+constexpr int MIN_PACKET_SIZE = 4;
+
+// Rounds to a packet size the kernels take: 4, 8 or 16
+inline int validPacketSize(int lanes) {
+    return lanes <= 4 ? 4 : (lanes <= 8 ? 8 : 16);
+}
+
+// Everything that is shared by every ray in a frame
+struct PacketScene {
+    float origin[3];
+    float center[3];
+    float radius;
+    float light[3];
+    float forward[3];
+    float right[3];
+    float up[3];
+    float widthAtDist1;
+    float heightAtDist1;
+};
+
+struct HitPacket {
+    alignas(32) float depth[PACKET_SIZE];
+    alignas(32) float pointX[PACKET_SIZE], pointY[PACKET_SIZE], pointZ[PACKET_SIZE];
+    alignas(32) float normalX[PACKET_SIZE], normalY[PACKET_SIZE], normalZ[PACKET_SIZE];
+    alignas(32) float diffuse[PACKET_SIZE];
+    alignas(32) int32_t hit[PACKET_SIZE];  // all ones on a hit, 0 on a miss
+};
+
+// Traces the first count lanes, count being one of the valid packet sizes
+typedef void (*PacketKernel)(const PacketScene& scene, const float* screenX, const float* screenY, int count,
+                             HitPacket& out);
+
+enum class PacketIsa {
+    Scalar,
+    SSE,
+    AVX2
+};
+
+void tracePacketScalar(const PacketScene& scene, const float* screenX, const float* screenY, int count,
+                       HitPacket& out);
+
+// Best kernel this CPU can actually run
+PacketIsa detectPacketIsa();
+
+// Falls back to the scalar kernel if the requested one isn't compiled in
+PacketKernel getPacketKernel(PacketIsa isa);
+
+const char* packetIsaName(PacketIsa isa);
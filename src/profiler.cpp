@@ -0,0 +1,100 @@
+#include "profiler.h"
+
+#include <cstdio>
+
+Profiler::Profiler() : enabled(false) {
+    for (int s = 0; s < PROFILE_STAGES; s++) stageTicks[s].store(0);
+    for (int c = 0; c < PROFILE_COUNTERS; c++) counts[c].store(0);
+    startTicks = now();
+    start = windowStart = std::chrono::steady_clock::now();
+}
+
+Profiler::Snapshot Profiler::take() {
+    uint64_t ticksNow = now();
+    std::chrono::steady_clock::time_point timeNow = std::chrono::steady_clock::now();
+    // Ticks per microsecond from the longest span we have, so short windows don't jitter it
+    double elapsedMicros = std::chrono::duration<double, std::micro>(timeNow - start).count();
+    double ticksPerMicro = elapsedMicros > 0.0 ? (ticksNow - startTicks) / elapsedMicros : 1.0;
+    if (ticksPerMicro <= 0.0) ticksPerMicro = 1.0;
+
+    Snapshot snapshot;
+    snapshot.seconds = std::chrono::duration<double>(timeNow - windowStart).count();
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        snapshot.micros[s] = stageTicks[s].exchange(0, std::memory_order_relaxed) / ticksPerMicro;
+    }
+    for (int c = 0; c < PROFILE_COUNTERS; c++) {
+        snapshot.counts[c] = counts[c].exchange(0, std::memory_order_relaxed);
+    }
+    windowStart = timeNow;
+    return snapshot;
+}
+
+const char* Profiler::stageName(ProfileStage stage) {
+    static const char* names[PROFILE_STAGES] = {"clear", "stars", "raygen", "intersect", "texture",
+                                                "shade", "aa", "encode", "write"};
+    return names[static_cast<int>(stage)];
+}
+
+const char* Profiler::counterName(ProfileCounter counter) {
+    static const char* names[PROFILE_COUNTERS] = {"rays", "hits", "bytes", "frames", "dropped", "late"};
+    return names[static_cast<int>(counter)];
+}
+
+std::string Profiler::formatLine(const Snapshot& snapshot) {
+    uint64_t frames = snapshot.counts[static_cast<int>(ProfileCounter::Frames)];
+    double perFrame = frames ? 1.0 / frames : 0.0;
+    auto ms = [&](ProfileStage stage) { return snapshot.micros[static_cast<int>(stage)] * perFrame * 1e-3; };
+    auto count = [&](ProfileCounter counter) { return snapshot.counts[static_cast<int>(counter)]; };
+    double render = 0.0;
+    for (int s = static_cast<int>(ProfileStage::Clear); s <= static_cast<int>(ProfileStage::Antialias); s++) {
+        render += ms(static_cast<ProfileStage>(s));
+    }
+    uint64_t rays = count(ProfileCounter::Rays);
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%.1f fps | render %.2fms (ray %.2f hit %.2f tex %.2f shade %.2f) | encode %.2f write %.2fms"
+                  " | %.0f%% hits | %.1fKB/f | late %llu dropped %llu",
+                  snapshot.seconds > 0.0 ? frames / snapshot.seconds : 0.0, render, ms(ProfileStage::RayGen),
+                  ms(ProfileStage::Intersect), ms(ProfileStage::Texture), ms(ProfileStage::Shade),
+                  ms(ProfileStage::Encode), ms(ProfileStage::Write),
+                  rays ? 100.0 * count(ProfileCounter::Hits) / rays : 0.0,
+                  count(ProfileCounter::Bytes) * perFrame / 1024.0,
+                  static_cast<unsigned long long>(count(ProfileCounter::Late)),
+                  static_cast<unsigned long long>(count(ProfileCounter::Dropped)));
+    return line;
+}
+
+std::string Profiler::formatJson(const Snapshot& snapshot) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "{\"seconds\": %.3f, \"stages_us\": {", snapshot.seconds);
+    std::string json = buffer;
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        std::snprintf(buffer, sizeof(buffer), "%s\"%s\": %.1f", s ? ", " : "", stageName(static_cast<ProfileStage>(s)),
+                      snapshot.micros[s]);
+        json += buffer;
+    }
+    json += "}";
+    for (int c = 0; c < PROFILE_COUNTERS; c++) {
+        std::snprintf(buffer, sizeof(buffer), ", \"%s\": %llu", counterName(static_cast<ProfileCounter>(c)),
+                      static_cast<unsigned long long>(snapshot.counts[c]));
+        json += buffer;
+    }
+    json += "}";
+    return json;
+}
+
+#if HELLOWORLD3D_PROFILE
+
+ProfileTile::~ProfileTile() {
+    if (!profiler) return;
+    // Scale the timed rows up to all of them
+    double scale = sampledRows ? static_cast<double>(rows) / sampledRows : 0.0;
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        if (ticks[s]) profiler->add(static_cast<ProfileStage>(s), static_cast<uint64_t>(ticks[s] * scale));
+    }
+    for (int c = 0; c < PROFILE_COUNTERS; c++) {
+        if (counts[c]) profiler->add(static_cast<ProfileCounter>(c), counts[c]);
+    }
+}
+
+#endif
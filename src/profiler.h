@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Set by the build (HELLOWORLD3D_PROFILE), on unless told otherwise. With 0 the scopes and tile
+// timers below are empty classes and every call on the render path compiles to nothing.
+#ifndef HELLOWORLD3D_PROFILE
+#define HELLOWORLD3D_PROFILE 1
+#endif
+
+enum class ProfileStage {
+    Clear,
+    Stars,
+    RayGen,
+    Intersect,
+    Texture,  // lat/lon and mip level, the trig before the texel read
+    Shade,    // texel read, lighting, clouds, night side
+    Antialias,
+    Encode,
+    Write,
+    Count
+};
+
+enum class ProfileCounter {
+    Rays,
+    Hits,
+    Bytes,
+    Frames,
+    Dropped,  // rendered but overwritten before display
+    Late,     // finished after the next frame was due
+    Count
+};
+
+constexpr int PROFILE_STAGES = static_cast<int>(ProfileStage::Count);
+constexpr int PROFILE_COUNTERS = static_cast<int>(ProfileCounter::Count);
+
+// Running totals of stage times and counters, added to from any thread. Times are in ticks
+// (TSC where there is one, steady_clock nanoseconds elsewhere) and turned into microseconds when
+// a window is taken.
+class Profiler {
+public:
+    static constexpr bool COMPILED_IN = HELLOWORLD3D_PROFILE != 0;
+
+    struct Snapshot {
+        double seconds;  // wall time the window covers
+        double micros[PROFILE_STAGES];
+        uint64_t counts[PROFILE_COUNTERS];
+    };
+
+private:
+    std::atomic<uint64_t> stageTicks[PROFILE_STAGES];
+    std::atomic<uint64_t> counts[PROFILE_COUNTERS];
+    std::atomic<bool> enabled;
+    std::chrono::steady_clock::time_point windowStart;
+    // For the tick rate, measured over everything since construction
+    uint64_t startTicks;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    Profiler();
+
+    // Off by default, the render path then only pays a branch per tile
+    void setEnabled(bool on) {
+        enabled.store(on && COMPILED_IN, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    void add(ProfileStage stage, uint64_t ticks) {
+        stageTicks[static_cast<int>(stage)].fetch_add(ticks, std::memory_order_relaxed);
+    }
+
+    void add(ProfileCounter counter, uint64_t n = 1) {
+        counts[static_cast<int>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // Everything since the previous take (or construction), and starts a new window
+    Snapshot take();
+
+    static const char* stageName(ProfileStage stage);
+    static const char* counterName(ProfileCounter counter);
+
+    // One line for the overlay: per-frame averages over the window
+    static std::string formatLine(const Snapshot& snapshot);
+
+    // One JSON object per window for the dump, no trailing newline
+    static std::string formatJson(const Snapshot& snapshot);
+};
+
+#if HELLOWORLD3D_PROFILE
+
+// Times the enclosing block into one stage
+class ProfileScope {
+private:
+    Profiler& profiler;
+    ProfileStage stage;
+    uint64_t begin;
+
+public:
+    ProfileScope(Profiler& p, ProfileStage s) : profiler(p), stage(s), begin(p.isEnabled() ? Profiler::now() : 0) {}
+
+    ~ProfileScope() {
+        if (begin) profiler.add(stage, Profiler::now() - begin);
+    }
+};
+
+// Per-tile accumulator for the per-ray stages, kept on the worker's stack and folded into the
+// profiler once at the end. Only every stride-th row is timed (one TSC read per stage
+// boundary), the rest are just counted and the times get scaled up at the end.
+class ProfileTile {
+private:
+    Profiler* profiler;  // null while profiling is off
+    uint64_t stride;
+    bool sampling;
+    uint64_t rows, sampledRows;
+    uint64_t last;
+    uint64_t ticks[PROFILE_STAGES];
+    uint64_t counts[PROFILE_COUNTERS];
+
+public:
+    explicit ProfileTile(Profiler& p, int rowStride = 8)
+        : profiler(p.isEnabled() ? &p : nullptr), stride(rowStride), sampling(false), rows(0), sampledRows(0), last(0), ticks(),
+          counts() {}
+
+    ~ProfileTile();
+
+    // A row, or any other unit of work the stages repeat over
+    void beginRow() {
+        if (!profiler) return;
+        sampling = rows++ % stride == 0;
+        if (sampling) {
+            sampledRows++;
+            last = Profiler::now();
+        }
+    }
+
+    // Charges the time since the previous mark (or beginRow) to stage
+    void mark(ProfileStage stage) {
+        if (!sampling) return;
+        uint64_t t = Profiler::now();
+        ticks[static_cast<int>(stage)] += t - last;
+        last = t;
+    }
+
+    void count(ProfileCounter counter, uint64_t n = 1) {
+        counts[static_cast<int>(counter)] += n;
+    }
+};
+
+#else
+
+class ProfileScope {
+public:
+    ProfileScope(Profiler&, ProfileStage) {}
+};
+
+class ProfileTile {
+public:
+    explicit ProfileTile(Profiler&, int = 8) {}
+    void beginRow() {}
+    void mark(ProfileStage) {}
+    void count(ProfileCounter, uint64_t = 1) {}
+};
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+// SplitMix64 finalizer: a counter goes in, 64 well mixed bits come out. No state, so any thread
+// can ask for "the random number for (seed, n)" and always gets the same one.
+inline uint64_t splitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Sequential SplitMix64 for one-off generation (continents, star catalogs, debris). Each
+// generator owns its state, unlike std::rand.
+class SplitMix {
+private:
+    uint64_t state;
+
+public:
+    explicit SplitMix(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t value = splitMix64(state);
+        state += 0x9e3779b97f4a7c15ull;
+        return value;
+    }
+
+    // [0, n)
+    int nextInt(int n) {
+        return static_cast<int>(next() % static_cast<uint64_t>(n));
+    }
+
+    // [0, 1)
+    double nextDouble() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+// Bit for bit the sequence glibc's rand() gives after srand(seed) (its TYPE_3 additive feedback
+// generator), without the shared global state. Only for keeping old seeded output as it was.
+class GlibcRand {
+private:
+    uint32_t r[34];  // the last 34 words, r[i] = r[i - 31] + r[i - 3]
+    unsigned n;
+
+    uint32_t step() {
+        uint32_t value = r[(n + 3) % 34] + r[(n + 31) % 34];
+        r[n % 34] = value;
+        n++;
+        return value;
+    }
+
+public:
+    explicit GlibcRand(unsigned seed) : n(34) {
+        int32_t word = seed == 0 ? 1 : static_cast<int32_t>(seed);
+        r[0] = static_cast<uint32_t>(word);
+        for (int i = 1; i < 31; i++) {
+            int64_t next = (16807LL * word) % 2147483647;
+            if (next < 0) next += 2147483647;
+            word = static_cast<int32_t>(next);
+            r[i] = static_cast<uint32_t>(word);
+        }
+        for (int i = 31; i < 34; i++) r[i] = r[i - 31];
+        for (int i = 0; i < 310; i++) step();
+    }
+
+    // [0, RAND_MAX] with glibc's RAND_MAX of 2^31 - 1
+    int next() {
+        return static_cast<int>(step() >> 1);
+    }
+
+    // next() % n, like the old rand() % n
+    int nextInt(int n) {
+        return next() % n;
+    }
+};
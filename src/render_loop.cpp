@@ -0,0 +1,112 @@
+#include "render_loop.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "terminal.h"
+#include "triple_buffer.h"
+
+void RenderLoop::report() {
+    Profiler::Snapshot snapshot = renderer.getProfiler().take();
+    if (!Profiler::COMPILED_IN) {
+        // Nothing got counted, the frame rate is all the loop can add
+        snapshot.counts[static_cast<int>(ProfileCounter::Frames)] = stats.displayed - reportedFrames;
+    }
+    reportedFrames = stats.displayed;
+    if (statsOverlay) renderer.setOverlay(Profiler::formatLine(snapshot));
+    if (statsDump) {
+        std::fprintf(statsDump, "%s\n", Profiler::formatJson(snapshot).c_str());
+        std::fflush(statsDump);
+    }
+}
+
+void RenderLoop::run(uint64_t maxFrames) {
+    TripleBuffer<FrameBuffer> frames(FrameBuffer(renderer.getOutputWidth(), renderer.getOutputHeight()));
+    std::atomic<uint64_t> published(0);
+    std::atomic<bool> producerDone(false);
+    // Only there to let the consumer sleep, the frames themselves go through the triple buffer
+    std::mutex doorbellLock;
+    std::condition_variable doorbell;
+
+    stats = Stats{0, 0, 0, 0, 0};
+    reportedFrames = 0;
+    scheduler.reset();
+    Profiler& profiler = renderer.getProfiler();
+    bool reporting = statsOverlay || statsDump;
+    if (reporting) {
+        profiler.setEnabled(true);
+        profiler.take();
+    }
+    typedef std::chrono::steady_clock Clock;
+    Clock::duration reportEvery = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(statsInterval));
+    Clock::time_point nextReport = Clock::now() + reportEvery;
+    if (terminalFd >= 0) watchTerminalResize();
+
+    std::thread producer([&] {
+        for (uint64_t count = 0; maxFrames == 0 || count < maxFrames; count++) {
+            uint64_t frame = scheduler.beginFrame();
+            // The renderer is only touched here, the buffers in the triple buffer get resized
+            // when they come round to swapFrame
+            int columns, rows;
+            if (terminalFd >= 0 && takeTerminalResize() && queryTerminalSize(terminalFd, columns, rows)) {
+                int w, h;
+                frameSizeForTerminal(columns, rows, reservedRows, w, h);
+                renderer.resize(w, h);
+            }
+            double angle = std::fmod(frame * rotationSpeed, 2.0 * PI);
+            if (scene) {
+                scene->animate(angle);
+                renderer.render(*scene);
+            } else {
+                earth.rotationY = angle;
+                renderer.render(earth);
+            }
+            renderer.swapFrame(frames.writeBuffer());
+            if (!frames.publish()) {
+                stats.dropped++;
+                if (reporting) profiler.add(ProfileCounter::Dropped);
+            }
+            stats.rendered++;
+            {
+                std::lock_guard<std::mutex> guard(doorbellLock);
+                published.fetch_add(1, std::memory_order_release);
+            }
+            doorbell.notify_one();
+            uint64_t missed = scheduler.getMissedDeadlines();
+            FrameScheduler::Clock::time_point next = scheduler.endFrame();
+            if (reporting && scheduler.getMissedDeadlines() != missed) profiler.add(ProfileCounter::Late);
+            std::this_thread::sleep_until(next);
+        }
+        {
+            std::lock_guard<std::mutex> guard(doorbellLock);
+            producerDone.store(true);
+        }
+        doorbell.notify_one();
+    });
+
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(doorbellLock);
+            doorbell.wait(guard, [&] { return published.load(std::memory_order_acquire) != seen || producerDone.load(); });
+            seen = published.load(std::memory_order_acquire);
+        }
+        if (frames.update()) {
+            renderer.display(frames.readBuffer(), outputFd);
+            stats.displayed++;
+            if (reporting && Clock::now() >= nextReport) {
+                report();
+                nextReport = Clock::now() + reportEvery;
+            }
+        } else if (producerDone.load()) {
+            break;
+        }
+    }
+    producer.join();
+    stats.skipped = scheduler.getSkippedFrames();
+    stats.missedDeadlines = scheduler.getMissedDeadlines();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+#include "ascii_renderer.h"
+#include "earth.h"
+#include "frame_scheduler.h"
+#include "scene.h"
+
+// Pipelined main loop. A producer thread renders frame N+1 while the calling thread encodes and
+// writes frame N, the two meet in a TripleBuffer of FrameBuffers. The producer is paced by a
+// FrameScheduler and the globe's angle comes from the frame number, so skipped frames keep the
+// spin on wall clock time. It can also follow the terminal's size, resizing the renderer
+// between frames on SIGWINCH.
+class RenderLoop {
+public:
+    struct Stats {
+        uint64_t rendered;         // frames the producer finished
+        uint64_t displayed;        // frames the consumer wrote out
+        uint64_t dropped;          // rendered but replaced before the consumer got to them
+        uint64_t skipped;          // never rendered, the scheduler jumped past them
+        uint64_t missedDeadlines;  // rendered, but finished after the next frame was due
+    };
+
+private:
+    ASCIIRenderer& renderer;
+    Earth& earth;
+    Scene* scene;
+    FrameScheduler scheduler;
+    double rotationSpeed;
+    int outputFd;
+    Stats stats;
+    double statsInterval;
+    bool statsOverlay;
+    std::FILE* statsDump;
+    uint64_t reportedFrames;
+    int terminalFd;
+    int reservedRows;
+
+    void report();
+
+public:
+    RenderLoop(ASCIIRenderer& renderer, Earth& earth, double fps, double rotationSpeed)
+        : renderer(renderer), earth(earth), scene(nullptr), scheduler(fps), rotationSpeed(rotationSpeed), outputFd(1),
+          stats{0, 0, 0, 0, 0}, statsInterval(1.0), statsOverlay(false), statsDump(nullptr),
+          reportedFrames(0), terminalFd(-1), reservedRows(0) {}
+
+    void setOutputFd(int fd) {
+        outputFd = fd;
+    }
+
+    // Every interval seconds the renderer's profiler window is turned into a stats line under
+    // the frame (overlay) and/or a JSON line appended to dump. Either one turns the profiler on.
+    void setStatsReport(double interval, bool overlay, std::FILE* dump) {
+        statsInterval = interval > 0.0 ? interval : 1.0;
+        statsOverlay = overlay;
+        statsDump = dump;
+    }
+
+    // Resize the frame to the terminal on fd whenever it changes size, leaving reserved rows
+    // for the banner and stats. -1 keeps the size fixed.
+    void followTerminal(int fd, int reserved) {
+        terminalFd = fd;
+        reservedRows = reserved;
+    }
+
+    // Frame size for a terminal of columns x rows with reserved rows taken up by other output
+    static void frameSizeForTerminal(int columns, int rows, int reserved, int& width, int& height) {
+        width = std::max(10, columns);
+        height = std::max(5, rows - reserved);
+    }
+
+    // Render a whole scene instead of the globe, animated from the same angle
+    void setScene(Scene* s) {
+        scene = s;
+    }
+
+    // Renders maxFrames frames (0 runs forever) and returns once the last one has been written
+    void run(uint64_t maxFrames = 0);
+
+    const Stats& getStats() const {
+        return stats;
+    }
+};
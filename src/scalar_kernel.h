@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "land_texture.h"
+#include "vec3.h"
+
+// Per-pixel geometry in whatever scalar the caller picks (double, float, Fixed). Camera and
+// Earth stay double, they describe the scene; what they hand the kernel gets converted to T
+// once per frame and every ray after that stays in T.
+template <typename T>
+struct ScalarScene {
+    Vec3T<T> origin;
+    Vec3T<T> center;
+    T radius;
+    Vec3T<T> light;
+    Vec3T<T> forward, right, up;
+    T widthAtDist1, heightAtDist1;
+};
+
+template <typename T>
+struct ScalarHit {
+    T depth;
+    Vec3T<T> normal;
+    Vec3T<T> dir;
+    T diffuse;
+    T lat, lon;  // base texture coordinates in radians, no spin
+};
+
+// What shading needs on top, also converted once per frame: the spin, the mip scale and the
+// texel scales of every texture level and of the city lights
+template <typename T>
+struct ScalarShading {
+    T spin;  // rotationY wrapped to [-PI, PI)
+    T mipScale;
+    std::vector<TexelScale<T>> texture;
+    TexelScale<T> cityLights;
+};
+
+// Same ray and closest non-negative root as Earth::intersectRay, but with a normalized
+// direction the quadratic loses its a and the factors of two
+template <typename T>
+inline bool traceScalar(const ScalarScene<T>& scene, T screenX, T screenY, ScalarHit<T>& hit) {
+    using std::asin;
+    using std::atan2;
+    using std::sqrt;
+    Vec3T<T> dir = (scene.forward + scene.right * (screenX * scene.widthAtDist1)
+                    + scene.up * (screenY * scene.heightAtDist1)).normalize();
+    Vec3T<T> oc = scene.origin - scene.center;
+    T b = oc.dot(dir);
+    T c = oc.dot(oc) - scene.radius * scene.radius;
+    T discriminant = b * b - c;
+    if (discriminant < T()) return false;
+
+    T root = sqrt(discriminant);
+    T t = -b - root;
+    if (t < T()) t = -b + root;
+    if (t < T()) return false;
+
+    hit.depth = t;
+    hit.dir = dir;
+    hit.normal = (oc + dir * t) * (T(1) / scene.radius);
+    T diffuse = hit.normal.dot(scene.light);
+    hit.diffuse = diffuse < T() ? T() : diffuse;
+    // Rounding can push a unit normal a hair past 1
+    T y = std::min(T(1), std::max(T(-1), hit.normal.y));
+    hit.lat = asin(y);
+    hit.lon = atan2(hit.normal.z, hit.normal.x);
+    return true;
+}
+
+// Earth::spinLongitude in T. Base longitude and spin are both in [-PI, PI], one wrap does.
+template <typename T>
+inline T spinLongitude(const ScalarShading<T>& shading, T lon) {
+    lon = lon + shading.spin;
+    if (lon >= T(PI)) lon = lon - T(2.0 * PI);
+    else if (lon < T(-PI)) lon = lon + T(2.0 * PI);
+    return lon;
+}
+
+// mipScale * surfaceFootprint in T. Capped at 2^12 texels per pixel, past any texture's coarsest
+// level anyway, so fixed point doesn't overflow where the surface is seen edge on.
+template <typename T>
+inline T texelsPerPixel(const ScalarShading<T>& shading, const ScalarHit<T>& hit) {
+    T facing = std::max(T(1e-3), -hit.normal.dot(hit.dir));
+    T texels = shading.mipScale * hit.depth;
+    return texels < T(4096) * facing ? texels / facing : T(4096);
+}
@@ -0,0 +1,94 @@
+#include "scene.h"
+
+#include <limits>
+
+#include "random.h"
+
+int Scene::addBody(const Earth& body, const Orbit& orbit, double spin) {
+    bodies.push_back(body);
+    orbits.push_back(orbit);
+    spins.push_back(spin);
+    dirty = true;
+    return static_cast<int>(bodies.size()) - 1;
+}
+
+void Scene::animate(double angle) {
+    for (size_t i = 0; i < bodies.size(); i++) {
+        Earth& body = bodies[i];
+        double spun = std::fmod(angle * spins[i], 2.0 * PI);
+        body.rotationY = spun < 0.0 ? spun + 2.0 * PI : spun;
+        const Orbit& orbit = orbits[i];
+        if (orbit.radius > 0.0) {
+            double a = orbit.phase + angle * orbit.speed;
+            Vec3 flat(std::cos(a) * orbit.radius, 0.0, std::sin(a) * orbit.radius);
+            body.position = orbit.center + rotate(flat, Vec3(1, 0, 0), orbit.tilt);
+        }
+    }
+    update();
+}
+
+void Scene::update() {
+    spheres.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); i++) {
+        spheres[i].center = bodies[i].position;
+        spheres[i].radius = bodies[i].radius;
+    }
+    if (dirty || bvh.empty() || ++updatesSinceBuild >= rebuildInterval) {
+        bvh.build(spheres);
+        updatesSinceBuild = 0;
+        dirty = false;
+    } else {
+        bvh.refit(spheres);
+    }
+}
+
+Vec3 Scene::lightDirection() const {
+    return bodies.empty() ? Vec3(1, 0.5, 0).normalize() : bodies[0].sunDirection();
+}
+
+bool Scene::intersect(const Vec3& origin, const Vec3& dir, Hit& hit) const {
+    double tMax = std::numeric_limits<double>::max();
+    return bvh.traverse(origin, dir, tMax, [&](int body, double& closest) {
+        double depth;
+        Vec3 point, normal;
+        if (!bodies[body].intersectRay(origin, dir, depth, point, normal) || depth >= closest) return false;
+        closest = depth;
+        hit.body = body;
+        hit.depth = depth;
+        hit.point = point;
+        hit.normal = normal;
+        return true;
+    });
+}
+
+bool Scene::intersectLinear(const Vec3& origin, const Vec3& dir, Hit& hit) const {
+    bool found = false;
+    hit.depth = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < bodies.size(); i++) {
+        double depth;
+        Vec3 point, normal;
+        if (!bodies[i].intersectRay(origin, dir, depth, point, normal) || depth >= hit.depth) continue;
+        hit.body = static_cast<int>(i);
+        hit.depth = depth;
+        hit.point = point;
+        hit.normal = normal;
+        found = true;
+    }
+    return found;
+}
+
+void addDebrisField(Scene& scene, int count, double innerRadius, double outerRadius, unsigned seed) {
+    SplitMix rng(seed);
+    auto next = [&rng]() { return rng.nextDouble(); };
+    for (int i = 0; i < count; i++) {
+        double orbitRadius = innerRadius + (outerRadius - innerRadius) * next();
+        double size = 0.03 + 0.09 * next();
+        Earth rock(size, Vec3(), 4, 8, seed + i);
+        rock.cloudy = false;
+        rock.inhabited = false;
+        // Inner rocks go round faster, roughly Kepler
+        double speed = 0.6 * std::pow(innerRadius / orbitRadius, 1.5);
+        Scene::Orbit orbit(Vec3(), orbitRadius, speed, 2.0 * PI * next(), 0.15 * (next() - 0.5));
+        scene.addBody(rock, orbit, 3.0 * next());
+    }
+}
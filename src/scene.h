@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "bvh.h"
+#include "earth.h"
+#include "vec3.h"
+
+// A set of textured spheres (planet, moons, debris), each with its own texture, spin and orbit,
+// behind a BVH so a ray costs about log(bodies) sphere tests instead of one per body. Body 0 is
+// the primary: it sets the light direction and the cloud phase.
+class Scene {
+public:
+    // Circular orbit around center in a plane tilted about X. radius 0 keeps the body where
+    // it was added.
+    struct Orbit {
+        Vec3 center;
+        double radius;
+        double speed;  // radians of orbit per radian of the primary's spin
+        double phase;
+        double tilt;
+
+        Orbit(const Vec3& c = Vec3(), double r = 0.0, double s = 0.0, double p = 0.0, double t = 0.0)
+            : center(c), radius(r), speed(s), phase(p), tilt(t) {}
+    };
+
+    struct Hit {
+        int body;
+        double depth;
+        Vec3 point;
+        Vec3 normal;
+    };
+
+private:
+    std::vector<Earth> bodies;
+    std::vector<Orbit> orbits;
+    std::vector<double> spins;  // spin per radian of the primary's spin
+    std::vector<Bvh::Sphere> spheres;
+    Bvh bvh;
+    int rebuildInterval;
+    int updatesSinceBuild;
+    bool dirty;
+
+public:
+    Scene() : rebuildInterval(30), updatesSinceBuild(0), dirty(true) {}
+
+    int addBody(const Earth& body, const Orbit& orbit = Orbit(), double spin = 1.0);
+
+    int getBodyCount() const {
+        return static_cast<int>(bodies.size());
+    }
+
+    const Earth& getBody(int i) const {
+        return bodies[i];
+    }
+
+    Earth& getBody(int i) {
+        return bodies[i];
+    }
+
+    // Refit every frame, full rebuild every n updates (and whenever bodies are added)
+    void setRebuildInterval(int updates) {
+        rebuildInterval = std::max(1, updates);
+    }
+
+    // Puts every body where it is at this spin angle of the primary and updates the BVH
+    void animate(double angle);
+
+    // Call after moving bodies by hand
+    void update();
+
+    const Bvh& getBvh() const {
+        return bvh;
+    }
+
+    // Same light as the single globe gets, from the primary's spin
+    Vec3 lightDirection() const;
+
+    // Closest hit through the BVH
+    bool intersect(const Vec3& origin, const Vec3& dir, Hit& hit) const;
+
+    // Closest hit by testing every body, for checking and benchmarking the BVH
+    bool intersectLinear(const Vec3& origin, const Vec3& dir, Hit& hit) const;
+};
+
+// Ring of count small bodies around the origin between innerRadius and outerRadius, all on
+// slightly tilted orbits. Tiny untextured-looking rocks: low resolution maps and no clouds.
+void addDebrisField(Scene& scene, int count, double innerRadius, double outerRadius, unsigned seed = 7);
@@ -0,0 +1,42 @@
+#include "starfield.h"
+
+#include <limits>
+
+#include "random.h"
+
+void Starfield::generate(int w, int h) {
+    width = w;
+    height = h;
+    // Same density as ever, one star per hundred cells and one in ten of them bright
+    int count = w * h / 100;
+    uint32_t cells = static_cast<uint32_t>(w) * h;
+    stars.resize(count);
+    SplitMix rng(seed);
+    for (int star = 0; star < count; star++) {
+        uint64_t r = rng.next();
+        uint32_t cell = static_cast<uint32_t>(r % cells);
+        bool bright = (r >> 40) % 10 == 0;
+        stars[star] = cell << 1 | (bright ? 1u : 0u);
+    }
+}
+
+void Starfield::draw(FrameBuffer& frame, uint32_t frameIndex, const CellRect& clip) {
+    if (frame.width != width || frame.height != height) generate(frame.width, frame.height);
+    const float empty = std::numeric_limits<float>::max();
+    for (size_t star = 0; star < stars.size(); star++) {
+        uint32_t cell = stars[star] >> 1;
+        bool bright = stars[star] & 1;
+        if (frame.depth[cell] != empty) continue;
+        if (!clip.contains(static_cast<int>(cell) % frame.width, static_cast<int>(cell) / frame.width)) continue;
+        if (twinkle) {
+            uint64_t r = splitMix64(seed ^ (static_cast<uint64_t>(star) << 32 | frameIndex));
+            // One frame in eight a star dips: bright ones to a dot, dim ones out
+            if (r % 8 == 0) {
+                if (!bright) continue;
+                bright = false;
+            }
+        }
+        frame.glyphs[cell] = bright ? '+' : '.';
+        frame.colors[cell] = ColorIndex::White;
+    }
+}
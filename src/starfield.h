@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "frame_buffer.h"
+
+// Star catalog for one viewport, generated once from a seed and blitted every frame. A star is
+// one word, its cell index shifted up with the bright flag in bit 0. Twinkle comes from a hash
+// of (seed, star, frame), so the same seed gives the same sky on any thread and any run.
+class Starfield {
+private:
+    uint64_t seed;
+    bool twinkle;
+    int width, height;
+    std::vector<uint32_t> stars;
+
+    void generate(int w, int h);
+
+public:
+    explicit Starfield(uint64_t seed = 42) : seed(seed), twinkle(false), width(0), height(0) {}
+
+    // Takes effect with the next frame, the catalog gets regenerated
+    void setSeed(uint64_t s) {
+        seed = s;
+        width = height = 0;
+    }
+
+    uint64_t getSeed() const {
+        return seed;
+    }
+
+    // Stars dim and bright ones flicker from frame to frame
+    void setTwinkle(bool enabled) {
+        twinkle = enabled;
+    }
+
+    bool getTwinkle() const {
+        return twinkle;
+    }
+
+    size_t getStarCount() const {
+        return stars.size();
+    }
+
+    // Puts the stars into cells nothing has been drawn in yet (depth still at its clear value).
+    // Regenerates the catalog if the frame changed size, otherwise allocation free.
+    void draw(FrameBuffer& frame, uint32_t frameIndex) {
+        draw(frame, frameIndex, frame.fullRect());
+    }
+
+    // Only the stars inside clip
+    void draw(FrameBuffer& frame, uint32_t frameIndex, const CellRect& clip);
+};
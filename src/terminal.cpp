@@ -0,0 +1,54 @@
+#include "terminal.h"
+
+#include <atomic>
+#include <csignal>
+
+#ifndef _WIN32
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Lock-free atomics are the only thing a signal handler can safely touch besides sig_atomic_t
+std::atomic<bool> resized(false);
+std::atomic<bool> watching(false);
+
+#ifndef _WIN32
+void onResize(int) {
+    resized.store(true, std::memory_order_relaxed);
+}
+#endif
+
+}  // namespace
+
+bool queryTerminalSize(int fd, int& columns, int& rows) {
+    #ifdef _WIN32
+    (void)fd;
+    (void)columns;
+    (void)rows;
+    return false;
+    #else
+    struct winsize size;
+    if (::ioctl(fd, TIOCGWINSZ, &size) != 0 || size.ws_col == 0 || size.ws_row == 0) return false;
+    columns = size.ws_col;
+    rows = size.ws_row;
+    return true;
+    #endif
+}
+
+void watchTerminalResize() {
+    #ifndef _WIN32
+    if (watching.exchange(true)) return;
+    struct sigaction action = {};
+    action.sa_handler = onResize;
+    sigemptyset(&action.sa_mask);
+    // Restart interrupted write()s and sleeps rather than failing them
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &action, nullptr);
+    #endif
+}
+
+bool takeTerminalResize() {
+    return resized.exchange(false, std::memory_order_relaxed);
+}
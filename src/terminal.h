@@ -0,0 +1,13 @@
+#pragma once
+
+// Terminal size and resize notifications. POSIX only, elsewhere the size is never known and
+// no resize ever arrives.
+
+// Columns and rows of the terminal on fd, false if fd isn't a terminal
+bool queryTerminalSize(int fd, int& columns, int& rows);
+
+// Installs a SIGWINCH handler (once) that just raises a flag
+void watchTerminalResize();
+
+// True once per resize since the last call
+bool takeTerminalResize();
@@ -0,0 +1,93 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads)
+    : currentJob(nullptr), remaining(0), generation(0), stopping(false) {
+    threads = std::max(1, threads);
+    for (int i = 0; i < threads; i++) {
+        queues.emplace_back(new WorkQueue());
+    }
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+bool ThreadPool::popJob(int index, int& job) {
+    {
+        WorkQueue& own = *queues[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    // Nothing left at home, go steal
+    int count = static_cast<int>(queues.size());
+    for (int i = 1; i < count; i++) {
+        WorkQueue& victim = *queues[(index + i) % count];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::drain(int index) {
+    int job;
+    while (popJob(index, job)) {
+        (*currentJob.load())(job);
+        if (remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> guard(stateLock);
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(int index) {
+    unsigned long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(stateLock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        drain(index);
+    }
+}
+
+void ThreadPool::parallelFor(int jobCount, const std::function<void(int)>& job) {
+    if (jobCount <= 0) return;
+    currentJob.store(&job);
+    remaining.store(jobCount);
+    int count = size();
+    for (int i = 0; i < jobCount; i++) {
+        WorkQueue& target = *queues[i % count];
+        std::lock_guard<std::mutex> guard(target.lock);
+        target.jobs.push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        generation++;
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> guard(stateLock);
+    finished.wait(guard, [&] { return remaining.load() == 0; });
+}
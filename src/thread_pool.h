@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool. Each thread owns a job deque, pops from its back and steals from
+// the front of the others when it runs dry. The calling thread joins in as worker 0.
+class ThreadPool {
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<int> jobs;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::mutex stateLock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::atomic<const std::function<void(int)>*> currentJob;
+    std::atomic<int> remaining;
+    unsigned long generation;
+    bool stopping;
+
+    bool popJob(int index, int& job);
+    void drain(int index);
+    void workerLoop(int index);
+
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const {
+        return static_cast<int>(queues.size());
+    }
+
+    // Runs job(0..jobCount-1) across the pool and blocks until every one has finished
+    void parallelFor(int jobCount, const std::function<void(int)>& job);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Single producer / single consumer handoff without locks. The producer always has a slot to
+// write into, the consumer always has the latest finished slot to read, and the third slot sits
+// in the middle. Publishing and picking up are one atomic exchange each. If the producer gets
+// ahead the unread middle frame just gets replaced, nobody ever waits on the other side.
+template <typename T>
+class TripleBuffer {
+private:
+    static constexpr uint8_t INDEX_MASK = 3;
+    static constexpr uint8_t FRESH = 4;  // middle slot holds a frame the consumer hasn't seen
+
+    T slots[3];
+    std::atomic<uint8_t> middle;
+    uint8_t back;   // producer only
+    uint8_t front;  // consumer only
+
+public:
+    explicit TripleBuffer(const T& initial = T())
+        : slots{initial, initial, initial}, middle(1), back(0), front(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer side
+    T& writeBuffer() {
+        return slots[back];
+    }
+
+    // Hands the write buffer over. Returns false if that replaced a frame the consumer never got.
+    bool publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+        return !(previous & FRESH);
+    }
+
+    // Consumer side. Swaps in the newest frame if there is one, false if nothing new was published.
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& readBuffer() const {
+        return slots[front];
+    }
+};
@@ -0,0 +1,28 @@
+#include "vec3.h"
+
+template <typename T>
+Vec3T<T> rotate(const Vec3T<T>& v, const Vec3T<T>& axis, T angle) {
+    using std::cos;
+    using std::sin;
+    T c = cos(angle);
+    T s = sin(angle);
+    T k = T(1) - c;
+
+    Vec3T<T> a = axis.normalize();
+    T ax = a.x, ay = a.y, az = a.z;
+
+    T rotMatrix[3][3] = {
+        {c + k * ax * ax, k * ax * ay - s * az, k * ax * az + s * ay},
+        {k * ay * ax + s * az, c + k * ay * ay, k * ay * az - s * ax},
+        {k * az * ax - s * ay, k * az * ay + s * ax, c + k * az * az}
+    };
+
+    return Vec3T<T>(
+        v.x * rotMatrix[0][0] + v.y * rotMatrix[0][1] + v.z * rotMatrix[0][2],
+        v.x * rotMatrix[1][0] + v.y * rotMatrix[1][1] + v.z * rotMatrix[1][2],
+        v.x * rotMatrix[2][0] + v.y * rotMatrix[2][1] + v.z * rotMatrix[2][2]
+    );
+}
+
+template Vec3T<double> rotate(const Vec3T<double>&, const Vec3T<double>&, double);
+template Vec3T<float> rotate(const Vec3T<float>&, const Vec3T<float>&, float);
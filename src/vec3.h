@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cmath>
+
+constexpr double PI = 3.14159265358979323846;
+
+// 3D Vector operations, on any scalar with the usual arithmetic (double, float, Fixed). sqrt is
+// looked up by argument so a scalar type can bring its own.
+template <typename T>
+struct Vec3T {
+    T x, y, z;
+
+    Vec3T(T x = T(), T y = T(), T z = T()) : x(x), y(y), z(z) {}
+
+    // Between precisions, e.g. a double scene handed to a float kernel
+    template <typename U>
+    explicit Vec3T(const Vec3T<U>& v) : x(static_cast<T>(v.x)), y(static_cast<T>(v.y)), z(static_cast<T>(v.z)) {}
+
+    // Operators (+/-/*)
+    Vec3T operator+(const Vec3T& v) const {
+        return Vec3T(x + v.x, y + v.y, z + v.z);
+    }
+
+    Vec3T operator-(const Vec3T& v) const {
+        return Vec3T(x - v.x, y - v.y, z - v.z);
+    }
+
+    Vec3T operator*(T s) const {
+        return Vec3T(x * s, y * s, z * s);
+    }
+
+    // dot Product
+    T dot(const Vec3T& v) const {
+        return x * v.x + y * v.y + z * v.z;
+    }
+
+    // Length & Magnitude
+    T length() const {
+        using std::sqrt;
+        return sqrt(x * x + y * y + z * z);
+    }
+
+    // Be normal!!!
+    Vec3T normalize() const {
+        T len = length();
+        if (len <= T(1e-10)) return Vec3T();
+        return Vec3T(x / len, y / len, z / len);
+    }
+
+    // Cross Product
+    Vec3T cross(const Vec3T& v) const {
+        return Vec3T(
+            y * v.z - z * v.y,
+            z * v.x - x * v.z,
+            x * v.y - y * v.x
+        );
+    }
+};
+
+typedef Vec3T<double> Vec3;
+typedef Vec3T<float> Vec3f;
+
+// I used Rodrigues' Rotation Formula (Axis-Angle Rotation) See readme or google it!
+template <typename T>
+Vec3T<T> rotate(const Vec3T<T>& v, const Vec3T<T>& axis, T angle);
+
+// Compiled once in vec3.cpp for double and float
+extern template Vec3T<double> rotate(const Vec3T<double>&, const Vec3T<double>&, double);
+extern template Vec3T<float> rotate(const Vec3T<float>&, const Vec3T<float>&, float);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Just enough of a test framework: TEST() registers a function, CHECK*() record failures
+// and keep going so one run shows everything that's broken.
+namespace test {
+
+struct Case {
+    const char* name;
+    std::function<void()> body;
+};
+
+inline std::vector<Case>& registry() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+struct Registrar {
+    Registrar(const char* name, std::function<void()> body) {
+        registry().push_back(Case{name, body});
+    }
+};
+
+inline void fail(const char* file, int line, const std::string& message) {
+    std::printf("  %s:%d: %s\n", file, line, message.c_str());
+    failures()++;
+}
+
+}  // namespace test
+
+#define TEST_CONCAT_(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_(a, b)
+
+#define TEST(name)                                                                        \
+    static void name();                                                                   \
+    static test::Registrar TEST_CONCAT(name, _registrar)(#name, name);                    \
+    static void name()
+
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) test::fail(__FILE__, __LINE__, "CHECK(" #cond ") failed");           \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                    \
+    do {                                                                                  \
+        if (!((a) == (b))) test::fail(__FILE__, __LINE__, "CHECK_EQ(" #a ", " #b ") failed"); \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance)                                                       \
+    do {                                                                                  \
+        double checkA_ = (a), checkB_ = (b);                                              \
+        if (!(std::fabs(checkA_ - checkB_) <= (tolerance))) {                             \
+            char checkMessage_[160];                                                      \
+            std::snprintf(checkMessage_, sizeof(checkMessage_), "CHECK_NEAR(" #a ", " #b ") failed: %g vs %g", \
+                          checkA_, checkB_);                                              \
+            test::fail(__FILE__, __LINE__, checkMessage_);                                \
+        }                                                                                 \
+    } while (0)
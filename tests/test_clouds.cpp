@@ -0,0 +1,44 @@
+#include <algorithm>
+
+#include "cloud_layer.h"
+#include "test.h"
+
+namespace {
+
+// What the renderer used to compute per pixel
+double exactClouds(double lat, double lon, double phase) {
+    double noise1 = std::sin(lat * 8.0 + phase * 0.5) * std::cos(lon * 6.0 + phase * 0.4);
+    double noise2 = std::sin(lat * 18.0 - phase * 0.8) * std::cos(lon * 14.0 - phase * 0.6);
+    double noise3 = std::sin(lat * 30.0 + phase * 1.2) * std::cos(lon * 25.0 + phase * 1.0);
+    double cloudValue = 0.4 * noise1 + 0.3 * noise2 + 0.3 * noise3;
+    cloudValue = (cloudValue + 0.3);
+    return std::max(0.0, cloudValue - 0.6) * 2.0;
+}
+
+}  // namespace
+
+TEST(cloudTableMatchesTrig) {
+    CloudLayer clouds;
+    const double phases[] = {0.0, 0.7, 3.1, 4.4};
+    for (double phase : phases) {
+        clouds.update(phase);
+        for (int i = 0; i < 400; i++) {
+            double lat = -PI / 2.0 + PI * (i * 0.6180339887 - std::floor(i * 0.6180339887));
+            double lon = -PI + 2.0 * PI * (i * 0.7548776662 - std::floor(i * 0.7548776662));
+            CHECK_NEAR(clouds.density(lat, lon), exactClouds(lat, lon, phase), 0.01);
+        }
+    }
+}
+
+TEST(cloudRefreshInterval) {
+    CloudLayer clouds;
+    clouds.setRefreshInterval(3);
+    clouds.update(0.0);
+    double lat = 0.3, lon = 1.1;
+    double baked = clouds.density(lat, lon);
+    clouds.update(1.0);
+    clouds.update(2.0);
+    CHECK_EQ(clouds.density(lat, lon), baked);
+    clouds.update(3.0);
+    CHECK_NEAR(clouds.density(lat, lon), exactClouds(lat, lon, 3.0), 0.01);
+}
@@ -0,0 +1,47 @@
+#include <string>
+
+#include "frame_buffer.h"
+#include "frame_encoder.h"
+#include "test.h"
+
+TEST(fullFrameClearsOnlyOnce) {
+    FrameBuffer frame(4, 2);
+    frame.glyphs[frame.index(1, 0)] = '#';
+    frame.colors[frame.index(1, 0)] = ColorIndex::Green;
+    FrameEncoder encoder;
+    std::string first = encoder.encode(frame, true, "footer\n");
+    CHECK_EQ(first.find("\033[2J"), size_t(0));
+    CHECK(first.find(Color::GREEN + "#") != std::string::npos);
+    CHECK(first.find("footer\n") != std::string::npos);
+    std::string second = encoder.encode(frame, true, "footer\n");
+    CHECK_EQ(second.find("\033[2J"), std::string::npos);
+    CHECK_EQ(second.find("\033[H"), size_t(0));
+    CHECK_EQ(encoder.getLastFrameBytes(), second.size());
+}
+
+TEST(monoFrameHasNoColorCodes) {
+    FrameBuffer frame(3, 1);
+    frame.colors[0] = ColorIndex::Red;
+    FrameEncoder encoder;
+    std::string out = encoder.encode(frame, false, "");
+    CHECK_EQ(out, std::string("\033[2J\033[H   \n"));
+}
+
+TEST(deltaSendsOnlyChangedCells) {
+    FrameBuffer frame(10, 3);
+    FrameEncoder encoder;
+    encoder.setDeltaMode(true);
+    encoder.encode(frame, false, "x\n");
+
+    // Nothing changed: only the cursor gets parked under the footer
+    CHECK_EQ(encoder.encode(frame, false, "x\n"), std::string("\033[5;1H"));
+
+    frame.glyphs[frame.index(2, 1)] = 'a';
+    frame.glyphs[frame.index(3, 1)] = 'b';
+    frame.glyphs[frame.index(9, 2)] = 'c';
+    CHECK_EQ(encoder.encode(frame, false, "x\n"), std::string("\033[2;3Hab\033[3;10Hc\033[5;1H"));
+
+    // A resize falls back to a full redraw
+    frame.resize(5, 2);
+    CHECK_EQ(encoder.encode(frame, false, "").find("\033[2J"), size_t(0));
+}
@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <string>
+
+#include "frame_sequence.h"
+#include "test.h"
+
+namespace {
+
+std::string tempPath(const char* name) {
+    return std::string("helloworld3d_test_") + name + ".frames";
+}
+
+FrameBuffer patternFrame(int width, int height, int seed) {
+    FrameBuffer frame(width, height);
+    for (int i = 0; i < width * height; i++) {
+        // Long runs with a few odd cells, including runs longer than 256
+        bool odd = (i * 7 + seed) % 97 == 0;
+        frame.glyphs[i] = odd ? '#' : (i < 300 ? ' ' : '~');
+        frame.colors[i] = odd ? ColorIndex::BrightGreen : ColorIndex::Blue;
+    }
+    return frame;
+}
+
+void roundTrip(bool rle) {
+    std::string path = tempPath(rle ? "rle" : "raw");
+    const int width = 40, height = 12, count = 5;
+    FrameSequenceWriter writer;
+    CHECK(writer.open(path, width, height, 12.5, rle));
+    for (int f = 0; f < count; f++) {
+        CHECK(writer.addFrame(patternFrame(width, height, f).view()));
+    }
+    CHECK(!writer.addFrame(FrameBuffer(3, 3).view()));  // wrong size
+    CHECK(writer.finish());
+
+    FrameSequence sequence;
+    std::string error;
+    CHECK(sequence.open(path, error));
+    CHECK_EQ(sequence.getWidth(), width);
+    CHECK_EQ(sequence.getHeight(), height);
+    CHECK_EQ(sequence.getFrameCount(), count);
+    CHECK_EQ(sequence.isCompressed(), rle);
+    CHECK_NEAR(sequence.getFps(), 12.5, 1e-9);
+
+    FrameBuffer scratch;
+    for (int f = 0; f < count; f++) {
+        FrameView view;
+        CHECK(sequence.frame(f, scratch, view));
+        FrameBuffer expected = patternFrame(width, height, f);
+        CHECK(std::equal(expected.glyphs.begin(), expected.glyphs.end(), view.glyphs));
+        CHECK(std::equal(expected.colors.begin(), expected.colors.end(), view.colors));
+        // Raw frames point into the mapping, only RLE needs the scratch buffer
+        CHECK_EQ(view.glyphs == scratch.glyphs.data(), rle);
+    }
+    FrameView view;
+    CHECK(!sequence.frame(count, scratch, view));
+    std::remove(path.c_str());
+}
+
+}  // namespace
+
+TEST(frameSequenceRawRoundTrip) {
+    roundTrip(false);
+}
+
+TEST(frameSequenceRleRoundTrip) {
+    roundTrip(true);
+}
+
+TEST(frameSequenceRejectsGarbage) {
+    std::string path = tempPath("garbage");
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    std::fputs("definitely not a frame sequence, but long enough to have a header", file);
+    std::fclose(file);
+    FrameSequence sequence;
+    std::string error;
+    CHECK(!sequence.open(path, error));
+    CHECK(!error.empty());
+    CHECK(!sequence.open(tempPath("missing"), error));
+    std::remove(path.c_str());
+}
+
+TEST(frameSequenceRejectsTruncatedFile) {
+    std::string path = tempPath("truncated");
+    FrameSequenceWriter writer;
+    writer.open(path, 8, 2, 10.0, false);
+    writer.addFrame(FrameBuffer(8, 2).view());
+    CHECK(writer.finish());
+    // Chop off the index
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    char bytes[256];
+    size_t n = std::fread(bytes, 1, sizeof(bytes), file);
+    std::fclose(file);
+    file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes, 1, n - 8, file);
+    std::fclose(file);
+
+    FrameSequence sequence;
+    std::string error;
+    CHECK(!sequence.open(path, error));
+    std::remove(path.c_str());
+}
+
+TEST(frameSequenceHeaderIsLittleEndian) {
+    std::string path = tempPath("endian");
+    FrameSequenceWriter writer;
+    writer.open(path, 300, 2, 10.0, false);
+    writer.addFrame(FrameBuffer(300, 2).view());
+    CHECK(writer.finish());
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    unsigned char bytes[40];
+    CHECK_EQ(std::fread(bytes, 1, sizeof(bytes), file), sizeof(bytes));
+    std::fclose(file);
+    std::remove(path.c_str());
+
+    CHECK(std::string(reinterpret_cast<const char*>(bytes), 8) == "HWFRAMES");
+    // version 1, width 300 = 0x012c, both low byte first
+    CHECK_EQ(bytes[8], 1);
+    CHECK_EQ(bytes[9], 0);
+    CHECK_EQ(bytes[16], 0x2c);
+    CHECK_EQ(bytes[17], 0x01);
+    // index right after the single 1200 byte frame (40 + 1200 = 0x04d8)
+    CHECK_EQ(bytes[32], 0xd8);
+    CHECK_EQ(bytes[33], 0x04);
+}
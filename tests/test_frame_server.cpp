@@ -0,0 +1,165 @@
+#ifdef __linux__
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "frame_server.h"
+#include "test.h"
+
+namespace {
+
+std::string socketAddress(const char* name) {
+    return "unix:/tmp/helloworld3d_test_" + std::string(name) + "_" + std::to_string(::getpid()) + ".sock";
+}
+
+}  // namespace
+
+TEST(frameServerFansOutPerSize) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    FrameServer server(earth, 200.0, 0.03);
+    std::string address = socketAddress("fanout");
+    std::string error;
+    CHECK(server.listen(address, error));
+
+    std::thread serverThread([&] { server.run(); });
+
+    std::FILE* capture = std::tmpfile();
+    long received[3] = {0, 0, 0};
+    std::thread clients[3] = {
+        std::thread([&] { received[0] = runFrameClient(address, 40, 12, fileno(capture), 20000); }),
+        std::thread([&] { received[1] = runFrameClient(address, 40, 12, -1, 20000); }),
+        std::thread([&] { received[2] = runFrameClient(address, 60, 20, -1, 20000); }),
+    };
+    for (std::thread& client : clients) client.join();
+    server.stop();
+    serverThread.join();
+
+    for (long bytes : received) CHECK(bytes >= 20000);
+    const FrameServer::Stats& stats = server.getStats();
+    CHECK_EQ(stats.clientsAccepted, uint64_t(3));
+    // Two sizes, so at most two renders per tick no matter how many clients
+    CHECK(stats.renders > 0 && stats.renders <= 2 * stats.frames);
+    CHECK(stats.framesSent > 0);
+
+    std::rewind(capture);
+    char start[8] = {0};
+    CHECK_EQ(std::fread(start, 1, 4, capture), size_t(4));
+    CHECK_EQ(std::string(start), std::string("\033[2J"));
+    std::fclose(capture);
+}
+
+// A client that reads slowly mustn't hold anyone else up, it just misses frames
+TEST(frameServerSkipsForSlowClients) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    FrameServer server(earth, 500.0, 0.03);
+    std::string address = socketAddress("slow");
+    std::string error;
+    CHECK(server.listen(address, error));
+
+    int slow = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un local;
+    local.sun_family = AF_UNIX;
+    std::snprintf(local.sun_path, sizeof(local.sun_path), "%s", address.c_str() + 5);
+    CHECK_EQ(::connect(slow, reinterpret_cast<sockaddr*>(&local), sizeof(local)), 0);
+    CHECK_EQ(::send(slow, "300x100\n", 8, 0), ssize_t(8));
+
+    // The slow client reads nothing until the fast one has its bytes. Those are far more than
+    // the socket buffers hold, so by then the slow one is stuck mid-frame with newer frames
+    // rendered behind it, however long each frame took. Draining more than the buffers hold
+    // makes the server finish that frame and jump to the newest.
+    std::thread serverThread([&] { server.run(); });
+    long fast = runFrameClient(address, 300, 100, -1, 4000000);
+    char buffer[4096];
+    long drained = 0;
+    while (drained < 2000000) {
+        ssize_t n = ::recv(slow, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        drained += n;
+    }
+    server.stop();
+    serverThread.join();
+    ::close(slow);
+
+    CHECK(fast >= 4000000);
+    CHECK(drained >= 2000000);
+    CHECK(server.getStats().framesSkipped > 0);
+}
+
+// Silent connections are dropped after the join timeout, a size line followed straight away by
+// a hangup is dropped without waiting for another edge
+TEST(frameServerDropsClientsThatNeverJoin) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    FrameServer server(earth, 100.0, 0.03);
+    server.setJoinTimeout(0.5);
+    std::string address = socketAddress("silent");
+    std::string error;
+    CHECK(server.listen(address, error));
+
+    int silent = connectSocket(address, error);
+    int hangup = connectSocket(address, error);
+    CHECK(silent >= 0 && hangup >= 0);
+    CHECK_EQ(::send(hangup, "40x12\n", 6, 0), ssize_t(6));
+    ::shutdown(hangup, SHUT_WR);
+
+    server.run(3);  // 30ms, well inside the timeout
+    CHECK_EQ(server.getStats().clientsAccepted, uint64_t(2));
+    CHECK_EQ(server.getClientCount(), 1);
+    CHECK_EQ(server.getGroupCount(), 0);
+    CHECK_EQ(server.getStats().clientsTimedOut, uint64_t(0));
+
+    server.run(80);
+    CHECK_EQ(server.getClientCount(), 0);
+    CHECK_EQ(server.getStats().clientsTimedOut, uint64_t(1));
+    char byte;
+    CHECK_EQ(::recv(silent, &byte, 1, 0), ssize_t(0));  // the server closed its end
+    ::close(silent);
+    ::close(hangup);
+}
+
+// --moon / --debris over the network: clients get the scene, not the bare globe
+TEST(frameServerRendersTheScene) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    Scene scene;
+    scene.addBody(earth);
+    Earth moon(0.8, Vec3(), 45, 90, 1969);
+    moon.cloudy = false;
+    scene.addBody(moon, Scene::Orbit(Vec3(), 5.5, 1.0, 0.5, 0.25), 1.0);
+
+    // No spin, so every tick is the same picture as rendering it here
+    ASCIIRenderer local(60, 20, true);
+    local.setDeltaOutput(false);
+    scene.animate(0.0);
+    local.render(scene);
+    local.encodeFrame();
+    // Without the screen clear a client's first frame starts with
+    std::string expected = local.encodeFrame();
+    ASCIIRenderer bare(60, 20, true);
+    bare.render(earth);
+    CHECK(bare.encodeFrame() != expected);
+
+    FrameServer server(earth, 200.0, 0.0);
+    server.setScene(&scene);
+    std::string address = socketAddress("scene");
+    std::string error;
+    CHECK(server.listen(address, error));
+    std::thread serverThread([&] { server.run(); });
+
+    std::FILE* capture = std::tmpfile();
+    long received = runFrameClient(address, 60, 20, fileno(capture), 3 * static_cast<long>(expected.size()));
+    server.stop();
+    serverThread.join();
+
+    CHECK(received >= 3 * static_cast<long>(expected.size()));
+    std::string stream(static_cast<size_t>(received), '\0');
+    std::rewind(capture);
+    CHECK_EQ(std::fread(&stream[0], 1, stream.size(), capture), stream.size());
+    std::fclose(capture);
+    CHECK(stream.find(expected) != std::string::npos);
+}
+
+#endif
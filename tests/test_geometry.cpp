@@ -0,0 +1,73 @@
+#include "camera.h"
+#include "earth.h"
+#include "test.h"
+#include "vec3.h"
+
+TEST(vec3Basics) {
+    Vec3 a(1, 2, 3), b(4, 5, 6);
+    CHECK_NEAR(a.dot(b), 32.0, 1e-12);
+    Vec3 c = a.cross(b);
+    CHECK_NEAR(c.x, -3.0, 1e-12);
+    CHECK_NEAR(c.y, 6.0, 1e-12);
+    CHECK_NEAR(c.z, -3.0, 1e-12);
+    CHECK_NEAR(Vec3(3, 4, 0).normalize().length(), 1.0, 1e-12);
+    CHECK_NEAR(Vec3().normalize().length(), 0.0, 1e-12);
+}
+
+TEST(rotateAboutY) {
+    Vec3 r = rotate(Vec3(1, 0, 0), Vec3(0, 1, 0), PI / 2.0);
+    CHECK_NEAR(r.x, 0.0, 1e-12);
+    CHECK_NEAR(r.y, 0.0, 1e-12);
+    CHECK_NEAR(r.z, -1.0, 1e-12);
+    // axis doesn't have to be unit length
+    Vec3 s = rotate(Vec3(0, 0, 2), Vec3(0, 5, 0), PI);
+    CHECK_NEAR(s.z, -2.0, 1e-12);
+}
+
+TEST(rayHitsAndMissesSphere) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    double depth;
+    Vec3 hitPoint, normal;
+    CHECK(earth.intersectRay(Vec3(0, 0, -8), Vec3(0, 0, 1), depth, hitPoint, normal));
+    CHECK_NEAR(depth, 5.0, 1e-12);
+    CHECK_NEAR(hitPoint.z, -3.0, 1e-12);
+    CHECK_NEAR(normal.z, -1.0, 1e-12);
+    CHECK(!earth.intersectRay(Vec3(0, 0, -8), Vec3(0, 1, 0), depth, hitPoint, normal));
+    CHECK(!earth.intersectRay(Vec3(0, 0, -8), Vec3(0, 0, -1), depth, hitPoint, normal));
+}
+
+TEST(cameraCenterRayLooksAtTarget) {
+    Camera camera(Vec3(0, 0, -8), Vec3(0, 0, 0), Vec3(0, 1, 0), 45.0, 1.2);
+    Vec3 dir = camera.rayDirection(0.0, 0.0);
+    CHECK_NEAR(dir.z, 1.0, 1e-12);
+    Vec3 corner = camera.rayDirection(1.0, 1.0);
+    CHECK_NEAR(corner.length(), 1.0, 1e-12);
+    CHECK(corner.x != 0.0 && corner.y > 0.0);
+}
+
+TEST(textureLevelFromFootprint) {
+    Earth earth(3.0, Vec3(0, 0, 0), 720, 1440);
+    CHECK_EQ(earth.textureLevel(0.0), 0);
+    CHECK_EQ(earth.textureLevel(0.9), 0);
+    CHECK_EQ(earth.textureLevel(1.0), 0);
+    CHECK_EQ(earth.textureLevel(2.5), 1);
+    CHECK_EQ(earth.textureLevel(4.0), 2);
+    CHECK_EQ(earth.textureLevel(1e9), earth.texture.getLevelCount() - 1);
+}
+
+// The spin as a longitude offset has to land on the same texel as actually rotating the point
+TEST(spinLongitudeMatchesRotation) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    for (int step = 0; step < 40; step++) {
+        earth.rotationY = step * 0.17;
+        for (int k = 0; k < 50; k++) {
+            double a = k * 0.61, b = k * 0.23 - 1.4;
+            Vec3 point = Vec3(std::cos(b) * std::cos(a), std::sin(b), std::cos(b) * std::sin(a)) * earth.radius;
+            double lat, lon;
+            earth.baseLatLon(point, lat, lon);
+            double spun = earth.spinLongitude(lon);
+            CHECK(spun >= -PI && spun < PI);
+            CHECK_EQ(earth.getTextureCharLatLon(lat, spun), earth.getTextureChar(point));
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#include <limits>
+#include <string>
+
+#include "ascii_renderer.h"
+#include "earth.h"
+#include "test.h"
+
+namespace {
+
+// Renders frames like the render loop does: into whichever buffer comes back from the swap
+void renderRotated(ASCIIRenderer& renderer, Earth& earth, FrameBuffer* spares, int frame) {
+    earth.rotationY = frame * 0.03;
+    renderer.render(earth);
+    renderer.swapFrame(spares[frame % 2]);
+}
+
+}  // namespace
+
+TEST(footprintCoversTheGlobe) {
+    ASCIIRenderer renderer(150, 50, true);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    renderer.render(earth);
+    CellRect rect = renderer.globeFootprint(earth);
+    const FrameBuffer& frame = renderer.getFrame();
+
+    int hits = 0;
+    for (int y = 0; y < frame.height; y++) {
+        for (int x = 0; x < frame.width; x++) {
+            if (frame.depth[frame.index(x, y)] == std::numeric_limits<float>::max()) continue;
+            hits++;
+            CHECK(rect.contains(x, y));
+        }
+    }
+    CHECK(hits > 500);
+    // Tight, not just the whole frame
+    long area = static_cast<long>(rect.x1 - rect.x0) * (rect.y1 - rect.y0);
+    CHECK(area < hits * 2);
+
+    // From inside the globe there's no footprint to speak of
+    Camera inside(Vec3(0, 0, 1), Vec3(0, 0, 5), Vec3(0, 1, 0), 45.0, 1.2);
+    renderer.setCamera(inside);
+    CHECK(renderer.globeFootprint(earth) == frame.fullRect());
+
+    // Behind the camera it's nothing at all
+    Camera away(Vec3(0, 0, -8), Vec3(0, 0, -20), Vec3(0, 1, 0), 45.0, 1.2);
+    renderer.setCamera(away);
+    CHECK(renderer.globeFootprint(earth) == frame.fullRect() || renderer.globeFootprint(earth).empty());
+}
+
+TEST(incrementalMatchesFullRender) {
+    const RenderPrecision precisions[] = {RenderPrecision::Double, RenderPrecision::Float};
+    for (RenderPrecision precision : precisions) {
+        ASCIIRenderer full(120, 40, true), partial(120, 40, true);
+        full.setAntialiasing(true);
+        partial.setAntialiasing(true);
+        full.setPrecision(precision);
+        partial.setPrecision(precision);
+        partial.setIncremental(true);
+        partial.setThreadCount(3);
+        Earth a(3.0, Vec3(0, 0, 0)), b(3.0, Vec3(0, 0, 0));
+        FrameBuffer spares[2];
+
+        for (int frame = 0; frame < 8; frame++) {
+            a.rotationY = frame * 0.03;
+            full.render(a);
+            renderRotated(partial, b, spares, frame);
+            const FrameBuffer& rendered = spares[frame % 2];
+            CHECK(rendered.glyphs == full.getFrame().glyphs);
+            CHECK(rendered.colors == full.getFrame().colors);
+            CHECK(rendered.backgroundKey != 0);
+            CHECK(rendered.dirty == partial.globeFootprint(b));
+        }
+    }
+}
+
+TEST(incrementalDeltaSendsOnlyTheFootprint) {
+    ASCIIRenderer renderer(150, 50, true);
+    renderer.setIncremental(true);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    FrameBuffer spares[2];
+    FrameEncoder tagged, plain;
+    tagged.setDeltaMode(true);
+    plain.setDeltaMode(true);
+
+    for (int frame = 0; frame < 6; frame++) {
+        renderRotated(renderer, earth, spares, frame);
+        FrameView view = spares[frame % 2].view();
+        std::string withRect = tagged.encode(view, true, "footer\n");
+        size_t changed = tagged.getLastChangedCells();
+        view.backgroundKey = 0;
+        // Same bytes as comparing every cell, just less work
+        CHECK(withRect == plain.encode(view, true, "footer\n"));
+        CHECK_EQ(changed, plain.getLastChangedCells());
+        if (frame > 0) {
+            CellRect rect = view.dirty;
+            CHECK(changed > 0);
+            CHECK(changed <= static_cast<size_t>((rect.x1 - rect.x0) * (rect.y1 - rect.y0)));
+        }
+    }
+    CHECK_EQ(renderer.getLastChangedCells(), 0u);  // nothing went through the renderer's own encoder
+}
+
+TEST(twinklingStarsRedrawTheBackground) {
+    ASCIIRenderer renderer(100, 40, true);
+    renderer.setIncremental(true);
+    renderer.getStars().setTwinkle(true);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    renderer.render(earth);
+    CHECK_EQ(renderer.getFrame().backgroundKey, 0u);
+    CHECK(renderer.getFrame().dirty == renderer.getFrame().fullRect());
+}
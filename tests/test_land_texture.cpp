@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <cstdlib>
+
+#include "earth.h"
+#include "land_texture.h"
+#include "random.h"
+#include "test.h"
+
+namespace {
+
+// FNV-1a over the land bits, row by row
+uint64_t landHash(const LandTexture& texture, int& land) {
+    uint64_t hash = 1469598103934665603ull;
+    land = 0;
+    for (int lat = 0; lat < texture.getLatRes(); lat++) {
+        for (int lon = 0; lon < texture.getLonRes(); lon++) {
+            bool bit = texture.get(lat, lon);
+            land += bit;
+            hash = (hash ^ static_cast<uint64_t>(bit)) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+}  // namespace
+
+TEST(landTextureSetGet) {
+    LandTexture texture(8, 130);  // row crosses a 64 bit word boundary
+    CHECK_EQ(texture.getLatRes(), 8);
+    CHECK_EQ(texture.getLonRes(), 130);
+    texture.set(3, 63, true);
+    texture.set(3, 64, true);
+    texture.set(7, 129, true);
+    CHECK(texture.get(3, 63));
+    CHECK(texture.get(3, 64));
+    CHECK(texture.get(7, 129));
+    CHECK(!texture.get(3, 62));
+    CHECK(!texture.get(3, 65));
+    texture.set(3, 64, false);
+    CHECK(!texture.get(3, 64));
+    CHECK(texture.get(3, 63));
+}
+
+// A mip texel is land when at least two of the four texels under it are
+TEST(landTextureMipRule) {
+    LandTexture texture(4, 4);
+    texture.set(0, 0, true);
+    texture.set(2, 2, true);
+    texture.set(2, 3, true);
+    texture.buildMips();
+    CHECK(texture.getLevelCount() >= 2);
+    // level 1 is 2x2, lat/lon in degrees
+    CHECK(!texture.isLand(-45.0, -90.0, 1));
+    CHECK(texture.isLand(45.0, 90.0, 1));
+    CHECK(!texture.isLand(-45.0, 90.0, 1));
+    // out of range levels clamp instead of reading garbage
+    CHECK_EQ(texture.isLand(45.0, 90.0, 99), texture.isLand(45.0, 90.0, texture.getLevelCount() - 1));
+    CHECK_EQ(texture.isLand(-45.0, -90.0, -3), texture.isLand(-45.0, -90.0, 0));
+}
+
+// Radian lookups in float and Fixed find the same texel as the double lookup at the largest
+// supported size. Each axis at the maximum on its own, the full square would be 512 MB.
+TEST(landTextureRadianLookupAtMaxResolution) {
+    const int max = LandTexture::MAX_RESOLUTION;
+    LandTexture tall(max, 2), wide(2, max);
+    // Neighbouring texels differ, so landing one off shows
+    for (int i = 0; i < max; i++) {
+        tall.set(i, 0, i % 3 == 0);
+        wide.set(0, i, i % 3 == 0);
+    }
+    TexelScale<Fixed> tallFixed = tall.texelScale<Fixed>(0), wideFixed = wide.texelScale<Fixed>(0);
+    TexelScale<float> tallFloat = tall.texelScale<float>(0), wideFloat = wide.texelScale<float>(0);
+    for (int i = 0; i < max; i += 37) {
+        // Texel centres, in radians
+        double lat = (i + 0.5) / max * PI - PI / 2.0;
+        double lon = (i + 0.5) / max * 2.0 * PI - PI;
+        double lon0 = -PI + 0.25 / max;
+        bool expectTall = i % 3 == 0;
+        CHECK_EQ(tall.isLand(lat * 180.0 / PI, lon0 * 180.0 / PI), expectTall);
+        CHECK_EQ(tall.isLandRad(Fixed(lat), Fixed(lon0), tallFixed, 0), expectTall);
+        CHECK_EQ(tall.isLandRad(static_cast<float>(lat), static_cast<float>(lon0), tallFloat, 0), expectTall);
+        CHECK_EQ(wide.isLand(-45.0, lon * 180.0 / PI), expectTall);
+        CHECK_EQ(wide.isLandRad(Fixed(-PI / 4.0), Fixed(lon), wideFixed, 0), expectTall);
+        CHECK_EQ(wide.isLandRad(static_cast<float>(-PI / 4.0), static_cast<float>(lon), wideFloat, 0), expectTall);
+    }
+    // The far edges, where the Q16.16 product used to wrap around
+    CHECK_EQ(wide.isLandRad(Fixed(-PI / 4.0), Fixed(PI - 1e-4), wideFixed, 0), wide.get(0, max - 2));
+    CHECK_EQ(tall.isLandRad(Fixed(PI / 2.0), Fixed(-3.0), tallFixed, 0), tall.get(max - 1, 0));
+    // Bigger requests are clamped to the maximum
+    LandTexture clamped(2, max * 2);
+    CHECK_EQ(clamped.getLonRes(), max);
+}
+
+TEST(earthTextureResolutionKeepsContinents) {
+    Earth coarse(3.0, Vec3(0, 0, 0));
+    Earth fine(3.0, Vec3(0, 0, 0), 720, 1440);
+    // Sample texel centers of the 1 degree map, well inside the shapes the finer map should agree
+    int agree = 0, total = 0;
+    for (int lat = -85; lat < 85; lat += 5) {
+        for (int lon = -175; lon < 180; lon += 5) {
+            total++;
+            if (coarse.isLand(lat + 0.5, lon + 0.5) == fine.isLand(lat + 0.5, lon + 0.5)) agree++;
+        }
+    }
+    CHECK(agree > total * 95 / 100);
+}
+
+// The map the globe has had since it used srand(42) / rand(), at both the default and a fine
+// resolution. Changing it should be a decision, not a side effect.
+TEST(defaultContinentsArePinned) {
+    int land;
+    Earth earth(3.0, Vec3(0, 0, 0));
+    CHECK_EQ(landHash(earth.texture, land), 0x8bbd9663a9edf480ull);
+    CHECK_EQ(land, 18011);
+    Earth fine(3.0, Vec3(0, 0, 0), 1800, 3600);
+    CHECK_EQ(landHash(fine.texture, land), 0x6aa3d7522db8bedaull);
+    CHECK_EQ(land, 1801315);
+
+    // Other seeds are other worlds
+    Earth other(3.0, Vec3(0, 0, 0), 180, 360, 7);
+    CHECK(landHash(other.texture, land) != 0x8bbd9663a9edf480ull);
+}
+
+// Every other seed builds its continents with SplitMix, pinned here through seed 7
+TEST(seededContinentsArePinned) {
+    int land;
+    Earth earth(3.0, Vec3(0, 0, 0), 180, 360, 7);
+    CHECK_EQ(landHash(earth.texture, land), 0xbb43d6b413d62b0aull);
+    CHECK_EQ(land, 16415);
+    Earth again(3.0, Vec3(0, 0, 0), 180, 360, 7);
+    CHECK_EQ(landHash(again.texture, land), 0xbb43d6b413d62b0aull);
+    Earth moon(3.0, Vec3(0, 0, 0), 180, 360, 1969);
+    CHECK_EQ(landHash(moon.texture, land), 0x7e503222aea2a842ull);
+    CHECK_EQ(land, 16701);
+}
+
+TEST(glibcRandMatchesRand) {
+    GlibcRand first(42);
+    CHECK_EQ(first.next(), 71876166);  // glibc's first rand() after srand(42)
+#ifdef __GLIBC__
+    const unsigned seeds[] = {0, 1, 42, 12345, 4000000000u};
+    for (unsigned seed : seeds) {
+        GlibcRand rng(seed);
+        std::srand(seed);
+        for (int i = 0; i < 1000; i++) CHECK_EQ(rng.next(), std::rand());
+    }
+#endif
+}
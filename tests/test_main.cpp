@@ -0,0 +1,20 @@
+#include <cstring>
+
+#include "test.h"
+
+// helloworld3d_tests [substring]  runs every test, or just the ones whose name contains substring
+int main(int argc, char* argv[]) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0, failed = 0;
+    for (const test::Case& testCase : test::registry()) {
+        if (filter && !std::strstr(testCase.name, filter)) continue;
+        int before = test::failures();
+        testCase.body();
+        run++;
+        bool ok = test::failures() == before;
+        if (!ok) failed++;
+        std::printf("%s %s\n", ok ? "[ ok ]" : "[FAIL]", testCase.name);
+    }
+    std::printf("%d tests, %d failed\n", run, failed);
+    return failed ? 1 : 0;
+}
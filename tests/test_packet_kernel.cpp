@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include "ascii_renderer.h"
+#include "camera.h"
+#include "earth.h"
+#include "packet_kernel.h"
+#include "test.h"
+
+namespace {
+
+PacketScene makeScene(const Camera& camera, const Earth& earth, const Vec3& light) {
+    PacketScene scene;
+    Vec3 forward, right, up;
+    double widthAtDist1, heightAtDist1;
+    camera.getBasis(forward, right, up, widthAtDist1, heightAtDist1);
+    const Vec3* sources[] = {&camera.position, &earth.position, &light, &forward, &right, &up};
+    float* targets[] = {scene.origin, scene.center, scene.light, scene.forward, scene.right, scene.up};
+    for (int v = 0; v < 6; v++) {
+        targets[v][0] = static_cast<float>(sources[v]->x);
+        targets[v][1] = static_cast<float>(sources[v]->y);
+        targets[v][2] = static_cast<float>(sources[v]->z);
+    }
+    scene.radius = static_cast<float>(earth.radius);
+    scene.widthAtDist1 = static_cast<float>(widthAtDist1);
+    scene.heightAtDist1 = static_cast<float>(heightAtDist1);
+    return scene;
+}
+
+// Every kernel this CPU can run against the double precision Earth::intersectRay
+void checkKernelAgainstScalar(PacketIsa isa, int packetSize) {
+    Camera camera(Vec3(0.3, -0.2, -8), Vec3(0, 0, 0), Vec3(0, 1, 0), 45.0, 1.2);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    Vec3 light = Vec3(0.6, 0.5, -0.4).normalize();
+    PacketScene scene = makeScene(camera, earth, light);
+    PacketKernel kernel = getPacketKernel(isa);
+
+    const int steps = 96;
+    float screenX[PACKET_SIZE], screenY[PACKET_SIZE];
+    HitPacket hits;
+    int compared = 0;
+    for (int row = 0; row < steps; row++) {
+        for (int start = 0; start < steps; start += packetSize) {
+            for (int lane = 0; lane < packetSize; lane++) {
+                screenX[lane] = -1.0f + 2.0f * (start + lane) / steps;
+                screenY[lane] = 1.0f - 2.0f * row / steps;
+            }
+            kernel(scene, screenX, screenY, packetSize, hits);
+
+            for (int lane = 0; lane < packetSize; lane++) {
+                Vec3 dir = camera.rayDirection(screenX[lane], screenY[lane]);
+                double depth;
+                Vec3 point, normal;
+                bool hit = earth.intersectRay(camera.position, dir, depth, point, normal);
+                // Right at the silhouette float and double can disagree, skip those rays
+                Vec3 toCenter = earth.position - camera.position;
+                double miss = (toCenter - dir * toCenter.dot(dir)).length() - earth.radius;
+                if (std::fabs(miss) < 1e-3) continue;
+
+                CHECK_EQ(hits.hit[lane] != 0, hit);
+                if (!hit || !hits.hit[lane]) continue;
+                compared++;
+                CHECK_NEAR(hits.depth[lane], depth, 1e-4 * depth);
+                CHECK_NEAR(hits.pointX[lane], point.x, 1e-3);
+                CHECK_NEAR(hits.pointY[lane], point.y, 1e-3);
+                CHECK_NEAR(hits.pointZ[lane], point.z, 1e-3);
+                CHECK_NEAR(hits.normalX[lane], normal.x, 1e-3);
+                CHECK_NEAR(hits.normalY[lane], normal.y, 1e-3);
+                CHECK_NEAR(hits.normalZ[lane], normal.z, 1e-3);
+                CHECK_NEAR(hits.diffuse[lane], std::max(0.0, normal.dot(light)), 1e-3);
+            }
+        }
+    }
+    CHECK(compared > steps * steps / 10);
+}
+
+}  // namespace
+
+const int packetSizes[] = {4, 8, 16};
+
+TEST(packetScalarMatchesIntersectRay) {
+    for (int size : packetSizes) checkKernelAgainstScalar(PacketIsa::Scalar, size);
+}
+
+TEST(packetSseMatchesIntersectRay) {
+    if (detectPacketIsa() < PacketIsa::SSE) return;
+    for (int size : packetSizes) checkKernelAgainstScalar(PacketIsa::SSE, size);
+}
+
+TEST(packetAvx2MatchesIntersectRay) {
+    if (detectPacketIsa() < PacketIsa::AVX2) return;
+    for (int size : packetSizes) checkKernelAgainstScalar(PacketIsa::AVX2, size);
+}
+
+TEST(packetSizesRenderTheSameFrame) {
+    CHECK_EQ(validPacketSize(1), 4);
+    CHECK_EQ(validPacketSize(8), 8);
+    CHECK_EQ(validPacketSize(12), 16);
+    CHECK_EQ(validPacketSize(64), 16);
+
+    Earth earth(3.0, Vec3(0, 0, 0));
+    ASCIIRenderer reference(90, 30, true);
+    reference.setPacketTracing(true);
+    reference.render(earth);
+    for (int size : packetSizes) {
+        ASCIIRenderer renderer(90, 30, true);
+        renderer.setPacketTracing(true);
+        renderer.setPacketSize(size);
+        CHECK_EQ(renderer.getPacketSize(), size);
+        renderer.render(earth);
+        CHECK(renderer.getFrame().glyphs == reference.getFrame().glyphs);
+        CHECK(renderer.getFrame().colors == reference.getFrame().colors);
+    }
+}
@@ -0,0 +1,161 @@
+#include "ascii_renderer.h"
+#include "fixed_point.h"
+#include "scalar_kernel.h"
+#include "test.h"
+
+namespace {
+
+// Fraction of cells whose glyph matches the double render, over a few spin angles
+double glyphAgreement(RenderPrecision precision, bool color, int textureLatRes = 180) {
+    ASCIIRenderer reference(150, 50, color), other(150, 50, color);
+    other.setPrecision(precision);
+    // Bigger textures get mipmapped, so the mip level picks get compared too
+    bool mipmapped = textureLatRes > 180;
+    reference.setTextureMipmapping(mipmapped);
+    other.setTextureMipmapping(mipmapped);
+    Earth earth(3.0, Vec3(0, 0, 0), textureLatRes, textureLatRes * 2);
+    long same = 0, total = 0;
+    for (int step = 0; step < 8; step++) {
+        earth.rotationY = step * 0.8;
+        reference.clearBuffers();
+        reference.renderSurface(earth);
+        other.clearBuffers();
+        other.renderSurface(earth);
+        const FrameBuffer& a = reference.getFrame();
+        const FrameBuffer& b = other.getFrame();
+        for (size_t i = 0; i < a.glyphs.size(); i++) {
+            same += a.glyphs[i] == b.glyphs[i];
+            total++;
+        }
+    }
+    return static_cast<double>(same) / total;
+}
+
+}  // namespace
+
+TEST(fixedPointArithmetic) {
+    Fixed a(3.25), b(-1.5);
+    CHECK_NEAR(static_cast<double>(a + b), 1.75, 1e-9);
+    CHECK_NEAR(static_cast<double>(a - b), 4.75, 1e-9);
+    CHECK_NEAR(static_cast<double>(a * b), -4.875, 1e-9);
+    CHECK_NEAR(static_cast<double>(a / b), -2.1666666, 1e-4);
+    CHECK_NEAR(static_cast<double>(-b), 1.5, 1e-9);
+    CHECK(b < a);
+    CHECK_NEAR(static_cast<double>(sqrt(Fixed(2.0))), std::sqrt(2.0), 2e-5);
+    CHECK_NEAR(static_cast<double>(sqrt(Fixed(60.0))), std::sqrt(60.0), 2e-5);
+    CHECK_NEAR(static_cast<double>(sqrt(Fixed(0.01))), 0.1, 1e-4);
+    CHECK_EQ(sqrt(Fixed(-1.0)).getRaw(), 0);
+}
+
+TEST(fixedPointDivisionSigns) {
+    CHECK_NEAR(static_cast<double>(Fixed(-3.0) / Fixed(1.5)), -2.0, 1e-9);
+    CHECK_NEAR(static_cast<double>(Fixed(-3.0) / Fixed(-0.5)), 6.0, 1e-9);
+    CHECK_NEAR(static_cast<double>(Fixed(-0.75) / Fixed(-2.0)), 0.375, 1e-9);
+    CHECK_NEAR(static_cast<double>(Fixed(-1.0) / Fixed(3.0)), -0.3333333, 1e-4);
+}
+
+TEST(fixedPointTrig) {
+    for (double v = -1.0; v <= 1.0; v += 0.01) {
+        CHECK_NEAR(static_cast<double>(asin(Fixed(v))), std::asin(v), 2e-4);
+    }
+    CHECK_NEAR(static_cast<double>(asin(Fixed(1.0))), PI / 2.0, 1e-4);
+    for (int step = 0; step < 360; step++) {
+        double angle = step * PI / 180.0;
+        for (double r = 0.05; r < 4.0; r *= 3.0) {
+            double y = r * std::sin(angle), x = r * std::cos(angle);
+            double expected = std::atan2(static_cast<double>(Fixed(y)), static_cast<double>(Fixed(x)));
+            double got = static_cast<double>(atan2(Fixed(y), Fixed(x)));
+            // +PI and -PI are the same longitude
+            if (std::abs(got - expected) > PI) got += got < 0 ? 2.0 * PI : -2.0 * PI;
+            CHECK_NEAR(got, expected, 2e-4);
+        }
+    }
+    CHECK_EQ(atan2(Fixed(), Fixed()).getRaw(), 0);
+    CHECK_EQ(static_cast<int>(Fixed(-2.75)), -2);
+    CHECK_EQ(static_cast<int>(Fixed(2.75)), 2);
+    CHECK_EQ(ilogb(Fixed(1.0)), 0);
+    CHECK_EQ(ilogb(Fixed(5.0)), 2);
+    CHECK_EQ(ilogb(Fixed(0.3)), -2);
+}
+
+// Texture and cloud lookups in float and Fixed land on the same texels and cover as double
+TEST(shadingLookupsInOtherPrecisions) {
+    Earth earth(3.0, Vec3(0, 0, 0), 360, 720);
+    CloudLayer clouds(256, 512);
+    clouds.update(1.3);
+    long same = 0, total = 0;
+    for (double lat = -1.55; lat < 1.56; lat += 0.0137) {
+        for (double lon = -3.14; lon < 3.14; lon += 0.0191) {
+            for (int level = 0; level < 3; level++) {
+                char expected = earth.getTextureCharLatLon(lat, lon, level);
+                same += earth.getTextureCharLatLon(static_cast<float>(lat), static_cast<float>(lon),
+                                                   earth.texture.texelScale<float>(level), level) == expected;
+                same += earth.getTextureCharLatLon(Fixed(lat), Fixed(lon), earth.texture.texelScale<Fixed>(level),
+                                                   level) == expected;
+                total += 2;
+            }
+            double cover = clouds.density(lat, lon);
+            CHECK_NEAR(clouds.density(static_cast<float>(lat), static_cast<float>(lon)), cover, 1e-4);
+            CHECK_NEAR(static_cast<double>(clouds.density(Fixed(lat), Fixed(lon))), cover, 2e-3);
+        }
+    }
+    // Only texels right on an edge may go either way
+    CHECK(same > total * 0.995);
+}
+
+TEST(vec3InOtherPrecisions) {
+    Vec3f f = Vec3f(3.0f, 0.0f, 4.0f).normalize();
+    CHECK_NEAR(f.x, 0.6, 1e-6);
+    CHECK_NEAR(f.z, 0.8, 1e-6);
+    Vec3T<Fixed> x = Vec3T<Fixed>(Vec3(3.0, 0.0, 4.0)).normalize();
+    CHECK_NEAR(static_cast<double>(x.x), 0.6, 1e-4);
+    CHECK_NEAR(static_cast<double>(x.length()), 1.0, 1e-4);
+    Vec3f r = rotate(Vec3f(1, 0, 0), Vec3f(0, 1, 0), static_cast<float>(PI / 2.0));
+    CHECK_NEAR(r.z, -1.0, 1e-6);
+}
+
+// Every precision hits the same sphere at the same place for a ray through the middle
+TEST(scalarKernelMatchesIntersectRay) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    Camera camera(Vec3(0, 0, -8), Vec3(0, 0, 0), Vec3(0, 1, 0), 45.0, 1.2);
+    Vec3 forward, right, up;
+    double w, h;
+    camera.getBasis(forward, right, up, w, h);
+    ScalarScene<float> fs = {Vec3f(camera.position), Vec3f(earth.position), 3.0f, Vec3f(0, 0, -1),
+                             Vec3f(forward), Vec3f(right), Vec3f(up), static_cast<float>(w), static_cast<float>(h)};
+    ScalarScene<Fixed> xs = {Vec3T<Fixed>(camera.position), Vec3T<Fixed>(earth.position), Fixed(3.0),
+                             Vec3T<Fixed>(Vec3(0, 0, -1)), Vec3T<Fixed>(forward), Vec3T<Fixed>(right),
+                             Vec3T<Fixed>(up), Fixed(w), Fixed(h)};
+    for (double sx = -0.2; sx <= 0.2; sx += 0.1) {
+        double depth;
+        Vec3 point, normal;
+        CHECK(earth.intersectRay(camera.position, camera.rayDirection(sx, 0.2), depth, point, normal));
+        ScalarHit<float> fh;
+        ScalarHit<Fixed> xh;
+        CHECK(traceScalar(fs, static_cast<float>(sx), 0.2f, fh));
+        CHECK(traceScalar(xs, Fixed(sx), Fixed(0.2), xh));
+        CHECK_NEAR(fh.depth, depth, 1e-4);
+        CHECK_NEAR(static_cast<double>(xh.depth), depth, 2e-3);
+        CHECK_NEAR(fh.normal.x, normal.x, 1e-4);
+        CHECK_NEAR(static_cast<double>(xh.normal.y), normal.y, 2e-3);
+    }
+}
+
+TEST(floatRenderAgreesWithDouble) {
+    double color = glyphAgreement(RenderPrecision::Float, true);
+    double mono = glyphAgreement(RenderPrecision::Float, false);
+    CHECK(color > 0.995);
+    CHECK(mono > 0.995);
+}
+
+TEST(fixedRenderAgreesWithDouble) {
+    double color = glyphAgreement(RenderPrecision::Fixed, true);
+    double mono = glyphAgreement(RenderPrecision::Fixed, false);
+    CHECK(color > 0.99);
+    CHECK(mono > 0.99);
+}
+
+TEST(mipmappedRenderAgreesWithDouble) {
+    CHECK(glyphAgreement(RenderPrecision::Float, true, 1800) > 0.995);
+    CHECK(glyphAgreement(RenderPrecision::Fixed, true, 1800) > 0.99);
+}
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <string>
+
+#include "ascii_renderer.h"
+#include "frame_encoder.h"
+#include "profiler.h"
+#include "render_loop.h"
+#include "test.h"
+
+namespace {
+
+uint64_t count(const Profiler::Snapshot& snapshot, ProfileCounter counter) {
+    return snapshot.counts[static_cast<int>(counter)];
+}
+
+double micros(const Profiler::Snapshot& snapshot, ProfileStage stage) {
+    return snapshot.micros[static_cast<int>(stage)];
+}
+
+}  // namespace
+
+TEST(profilerOffRecordsNothing) {
+    ASCIIRenderer renderer(80, 30);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    renderer.getProfiler().take();
+    renderer.render(earth);
+    Profiler::Snapshot snapshot = renderer.getProfiler().take();
+    for (int c = 0; c < PROFILE_COUNTERS; c++) CHECK_EQ(snapshot.counts[c], uint64_t(0));
+    for (int s = 0; s < PROFILE_STAGES; s++) CHECK_EQ(snapshot.micros[s], 0.0);
+}
+
+TEST(profilerCountsRaysAndStages) {
+    if (!Profiler::COMPILED_IN) return;
+    ASCIIRenderer renderer(80, 30);
+    renderer.setThreadCount(3);
+    Profiler& profiler = renderer.getProfiler();
+    profiler.setEnabled(true);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    for (int frame = 0; frame < 4; frame++) {
+        renderer.render(earth);
+        renderer.encodeFrame();
+    }
+    Profiler::Snapshot snapshot = profiler.take();
+    CHECK_EQ(count(snapshot, ProfileCounter::Frames), uint64_t(4));
+    CHECK_EQ(count(snapshot, ProfileCounter::Rays), uint64_t(4 * 80 * 30));
+    CHECK(count(snapshot, ProfileCounter::Hits) > 0);
+    CHECK(count(snapshot, ProfileCounter::Hits) < count(snapshot, ProfileCounter::Rays));
+    CHECK(micros(snapshot, ProfileStage::Clear) > 0.0);
+    CHECK(micros(snapshot, ProfileStage::Stars) > 0.0);
+    CHECK(micros(snapshot, ProfileStage::RayGen) > 0.0);
+    CHECK(micros(snapshot, ProfileStage::Intersect) > 0.0);
+    CHECK(micros(snapshot, ProfileStage::Texture) > 0.0);
+    CHECK(micros(snapshot, ProfileStage::Shade) > 0.0);
+    CHECK(snapshot.seconds > 0.0);
+
+    // take() starts a new window
+    Profiler::Snapshot empty = profiler.take();
+    CHECK_EQ(count(empty, ProfileCounter::Rays), uint64_t(0));
+
+    // The packet path counts the same rays
+    renderer.setPacketTracing(true);
+    renderer.render(earth);
+    CHECK_EQ(count(profiler.take(), ProfileCounter::Rays), uint64_t(80 * 30));
+}
+
+TEST(profilerFormats) {
+    Profiler::Snapshot snapshot = {};
+    snapshot.seconds = 2.0;
+    snapshot.counts[static_cast<int>(ProfileCounter::Frames)] = 20;
+    snapshot.counts[static_cast<int>(ProfileCounter::Rays)] = 1000;
+    snapshot.counts[static_cast<int>(ProfileCounter::Hits)] = 250;
+    snapshot.micros[static_cast<int>(ProfileStage::Shade)] = 20000.0;
+    std::string line = Profiler::formatLine(snapshot);
+    CHECK(line.find("10.0 fps") != std::string::npos);
+    CHECK(line.find("shade 1.00") != std::string::npos);
+    CHECK(line.find("25% hits") != std::string::npos);
+    std::string json = Profiler::formatJson(snapshot);
+    CHECK(json.find("\"shade\": 20000.0") != std::string::npos);
+    CHECK(json.find("\"rays\": 1000") != std::string::npos);
+    CHECK(json.front() == '{' && json.back() == '}');
+}
+
+TEST(overlayFollowsTheFooter) {
+    FrameBuffer frame(10, 3);
+    FrameEncoder encoder;
+    encoder.setDeltaMode(true);
+    encoder.setOverlay("stats here");
+    CHECK(encoder.encode(frame, false, "footer\n").find("footer\n\033[2Kstats here\n") != std::string::npos);
+    // Unchanged: delta frames leave it alone
+    CHECK(encoder.encode(frame, false, "footer\n").find("stats here") == std::string::npos);
+    encoder.setOverlay("new stats");
+    CHECK(encoder.encode(frame, false, "footer\n").find("new stats") != std::string::npos);
+}
+
+TEST(clearedOverlayIsErased) {
+    const bool deltaModes[] = {true, false};
+    for (bool deltaMode : deltaModes) {
+        FrameBuffer frame(10, 3);
+        FrameEncoder encoder;
+        encoder.setDeltaMode(deltaMode);
+        encoder.setOverlay("stats here");
+        encoder.encode(frame, false, "footer\n");
+        encoder.setOverlay("");
+        std::string cleared = encoder.encode(frame, false, "footer\n");
+        CHECK(cleared.find("\033[2K") != std::string::npos);
+        CHECK(cleared.find("stats here") == std::string::npos);
+        // Wiped once, then nothing more to do
+        CHECK(encoder.encode(frame, false, "footer\n").find("\033[2K") == std::string::npos);
+    }
+}
+
+TEST(renderLoopDumpsStats) {
+    std::FILE* dump = std::tmpfile();
+    CHECK(dump != nullptr);
+    if (!dump) return;
+    ASCIIRenderer renderer(60, 20, false);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    RenderLoop loop(renderer, earth, 200.0, 0.03);
+    loop.setOutputFd(-1);
+    loop.setStatsReport(0.02, true, dump);
+    loop.run(30);
+
+    std::rewind(dump);
+    char line[1024];
+    int lines = 0;
+    while (std::fgets(line, sizeof(line), dump)) {
+        lines++;
+        CHECK(std::string(line).find("\"frames\": ") != std::string::npos);
+    }
+    std::fclose(dump);
+    CHECK(lines >= 2);
+}
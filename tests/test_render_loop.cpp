@@ -0,0 +1,98 @@
+#include <chrono>
+#include <thread>
+
+#include "frame_scheduler.h"
+#include "render_loop.h"
+#include "test.h"
+#include "triple_buffer.h"
+
+TEST(tripleBufferHandsOverLatest) {
+    TripleBuffer<int> buffer(0);
+    CHECK(!buffer.update());
+
+    buffer.writeBuffer() = 1;
+    CHECK(buffer.publish());
+    CHECK(buffer.update());
+    CHECK_EQ(buffer.readBuffer(), 1);
+    CHECK(!buffer.update());
+    CHECK_EQ(buffer.readBuffer(), 1);
+
+    // Consumer fell behind: frame 2 is replaced by 3 and reported as dropped
+    buffer.writeBuffer() = 2;
+    CHECK(buffer.publish());
+    buffer.writeBuffer() = 3;
+    CHECK(!buffer.publish());
+    CHECK(buffer.update());
+    CHECK_EQ(buffer.readBuffer(), 3);
+}
+
+TEST(tripleBufferAcrossThreads) {
+    TripleBuffer<std::pair<int, int>> buffer(std::make_pair(0, 0));
+    const int count = 20000;
+    std::thread producer([&] {
+        for (int i = 1; i <= count; i++) {
+            buffer.writeBuffer() = std::make_pair(i, -i);
+            buffer.publish();
+        }
+    });
+    int last = 0;
+    bool ordered = true, torn = false;
+    while (last < count) {
+        if (!buffer.update()) continue;
+        const std::pair<int, int>& value = buffer.readBuffer();
+        if (value.first < last) ordered = false;
+        if (value.second != -value.first) torn = true;
+        last = value.first;
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK(!torn);
+}
+
+TEST(schedulerSkipsInsteadOfDrifting) {
+    typedef FrameScheduler::Clock Clock;
+    FrameScheduler scheduler(10.0);
+    Clock::time_point t0 = Clock::now();
+    scheduler.reset(t0);
+    std::chrono::milliseconds ms(1);
+
+    CHECK_EQ(scheduler.beginFrame(t0), uint64_t(0));
+    CHECK(scheduler.endFrame(t0 + 30 * ms) == t0 + 100 * ms);
+
+    // On time
+    CHECK_EQ(scheduler.beginFrame(t0 + 100 * ms), uint64_t(1));
+    CHECK(scheduler.endFrame(t0 + 150 * ms) == t0 + 200 * ms);
+    CHECK_EQ(scheduler.getMissedDeadlines(), uint64_t(0));
+
+    // Frame 2 takes 250ms: misses its deadline and frame 3 gets skipped
+    CHECK_EQ(scheduler.beginFrame(t0 + 200 * ms), uint64_t(2));
+    CHECK(scheduler.endFrame(t0 + 450 * ms) == t0 + 300 * ms);
+    CHECK_EQ(scheduler.getMissedDeadlines(), uint64_t(1));
+    CHECK_EQ(scheduler.beginFrame(t0 + 450 * ms), uint64_t(4));
+    CHECK_EQ(scheduler.getSkippedFrames(), uint64_t(1));
+    // and the schedule stays anchored to t0
+    CHECK(scheduler.endFrame(t0 + 460 * ms) == t0 + 500 * ms);
+    CHECK_EQ(scheduler.getMissedDeadlines(), uint64_t(1));
+}
+
+TEST(schedulerUnpaced) {
+    FrameScheduler scheduler(0.0);
+    FrameScheduler::Clock::time_point now = FrameScheduler::Clock::now();
+    scheduler.reset(now);
+    CHECK_EQ(scheduler.beginFrame(now + std::chrono::seconds(5)), uint64_t(0));
+    CHECK(scheduler.endFrame(now) == now);
+    CHECK_EQ(scheduler.beginFrame(now), uint64_t(1));
+    CHECK_EQ(scheduler.getSkippedFrames(), uint64_t(0));
+}
+
+TEST(renderLoopRunsToCompletion) {
+    ASCIIRenderer renderer(60, 20, false);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    RenderLoop loop(renderer, earth, 0.0, 0.03);
+    loop.setOutputFd(-1);  // writes fail quietly, we only care about the handoff
+    loop.run(30);
+    const RenderLoop::Stats& stats = loop.getStats();
+    CHECK_EQ(stats.rendered, uint64_t(30));
+    CHECK(stats.displayed >= 1);
+    CHECK_EQ(stats.displayed + stats.dropped, stats.rendered);
+}
@@ -0,0 +1,167 @@
+#include <limits>
+#include <vector>
+
+#include "ascii_renderer.h"
+#include "earth.h"
+#include "test.h"
+
+namespace {
+
+// Stars included, both renderers' starfields come from the same default seed
+bool sameFrames(ASCIIRenderer& a, ASCIIRenderer& b, int frames, int* mismatches = nullptr) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    int differing = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        a.clearBuffers();
+        b.clearBuffers();
+        a.renderStars();
+        b.renderStars();
+        a.renderSurface(earth);
+        b.renderSurface(earth);
+        const FrameBuffer& fa = a.getFrame();
+        const FrameBuffer& fb = b.getFrame();
+        for (size_t i = 0; i < fa.glyphs.size(); i++) {
+            if (fa.glyphs[i] != fb.glyphs[i] || fa.colors[i] != fb.colors[i]) differing++;
+        }
+        earth.rotationY += 0.37;
+    }
+    if (mismatches) *mismatches = differing;
+    return differing == 0;
+}
+
+}  // namespace
+
+TEST(threadedRenderMatchesSerial) {
+    ASCIIRenderer serial(150, 50);
+    ASCIIRenderer threaded(150, 50);
+    threaded.setThreadCount(4);
+    CHECK_EQ(threaded.getThreadCount(), 4);
+    CHECK(sameFrames(serial, threaded, 8));
+}
+
+TEST(geometryCacheMatchesUncached) {
+    ASCIIRenderer plain(120, 40);
+    ASCIIRenderer cached(120, 40);
+    cached.setGeometryCache(true);
+    cached.setThreadCount(3);
+    CHECK(sameFrames(plain, cached, 8));
+
+    // Moving the camera has to rebuild the cache
+    Camera moved(Vec3(1, 0.5, -7), Vec3(0, 0, 0), Vec3(0, 1, 0), 45.0, 120.0 / 40 * 0.4);
+    plain.setCamera(moved);
+    cached.setCamera(moved);
+    CHECK(sameFrames(plain, cached, 4));
+}
+
+TEST(packetRenderCloseToScalar) {
+    ASCIIRenderer scalar(150, 50);
+    ASCIIRenderer packet(150, 50);
+    packet.setPacketTracing(true);
+    int mismatches = 0;
+    sameFrames(scalar, packet, 8, &mismatches);
+    // float vs double only flips cells sitting right on a shading threshold
+    CHECK(mismatches < 150 * 50 * 8 / 100);
+}
+
+TEST(antialiasingOnlyTouchesEdgeCells) {
+    ASCIIRenderer plain(120, 40);
+    ASCIIRenderer smooth(120, 40);
+    smooth.setAntialiasing(true, 4);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    earth.rotationY = 1.3;
+    plain.clearBuffers();
+    plain.renderSurface(earth);
+    smooth.clearBuffers();
+    smooth.renderSurface(earth);
+
+    const ASCIIRenderer::AntialiasStats& stats = smooth.getAntialiasStats();
+    CHECK(stats.edgeCells > 0);
+    CHECK_EQ(stats.refinedCells, stats.edgeCells);
+    CHECK_EQ(stats.rays, static_cast<long>(stats.edgeCells) * 16);
+    CHECK(!stats.overBudget);
+
+    // Far from the limb and coasts nothing changes
+    const FrameBuffer& a = plain.getFrame();
+    const FrameBuffer& b = smooth.getFrame();
+    int changed = 0;
+    for (size_t i = 0; i < a.glyphs.size(); i++) {
+        if (a.glyphs[i] != b.glyphs[i] || a.colors[i] != b.colors[i]) changed++;
+    }
+    CHECK(changed > 0 && changed <= stats.edgeCells);
+}
+
+// On a globe this small some limb cells have their own ray hit but most sub-cell rays miss.
+// Antialiasing blanks those, and the stars behind them have to come back.
+TEST(antialiasingKeepsStarsBehindBlankedCells) {
+    Earth earth(0.1, Vec3(-1.52, -1.0, 0));
+    ASCIIRenderer plain(120, 40);
+    ASCIIRenderer smooth(120, 40);
+    smooth.setAntialiasing(true, 3);
+    plain.clearBuffers();
+    plain.renderSurface(earth);
+    smooth.clearBuffers();
+    smooth.renderSurface(earth);
+    const float empty = std::numeric_limits<float>::max();
+    std::vector<size_t> blanked;
+    for (size_t i = 0; i < plain.getFrame().depth.size(); i++) {
+        if (plain.getFrame().depth[i] != empty && smooth.getFrame().depth[i] == empty) blanked.push_back(i);
+    }
+    CHECK(!blanked.empty());
+    if (blanked.empty()) return;
+
+    // Look for a sky with a star in one of them
+    ASCIIRenderer sky(120, 40);
+    int cell = -1;
+    uint64_t seed = 0;
+    while (cell < 0 && ++seed < 10000) {
+        sky.getStars().setSeed(seed);
+        sky.clearBuffers();
+        sky.renderStars();
+        for (size_t i : blanked) {
+            if (sky.getFrame().glyphs[i] != ' ') cell = static_cast<int>(i);
+        }
+    }
+    CHECK(cell >= 0);
+    if (cell < 0) return;
+
+    smooth.getStars().setSeed(seed);
+    smooth.clearBuffers();
+    smooth.renderStars();
+    smooth.renderSurface(earth);
+    CHECK_EQ(smooth.getFrame().glyphs[cell], sky.getFrame().glyphs[cell]);
+    CHECK(smooth.getFrame().colors[cell] == sky.getFrame().colors[cell]);
+}
+
+TEST(antialiasingRespectsRayBudget) {
+    ASCIIRenderer renderer(120, 40);
+    renderer.setAntialiasing(true, 4);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    renderer.clearBuffers();
+    renderer.renderSurface(earth);
+    int edgeCells = renderer.getAntialiasStats().edgeCells;
+
+    // Enough for a 3x3 grid everywhere: the grid shrinks but every cell is still refined
+    renderer.setAntialiasBudget(edgeCells * 9, 0.0);
+    renderer.clearBuffers();
+    renderer.renderSurface(earth);
+    CHECK_EQ(renderer.getAntialiasStats().samplesPerAxis, 3);
+    CHECK_EQ(renderer.getAntialiasStats().refinedCells, edgeCells);
+    CHECK(renderer.getAntialiasStats().overBudget);
+
+    // Not even 2x2 for everyone: cells get dropped, rays stay under the cap
+    renderer.setAntialiasBudget(100, 0.0);
+    renderer.clearBuffers();
+    renderer.renderSurface(earth);
+    CHECK_EQ(renderer.getAntialiasStats().samplesPerAxis, 2);
+    CHECK(renderer.getAntialiasStats().rays <= 100);
+    CHECK(renderer.getAntialiasStats().refinedCells < edgeCells);
+}
+
+TEST(antialiasingThreadedMatchesSerial) {
+    ASCIIRenderer serial(150, 50);
+    ASCIIRenderer threaded(150, 50);
+    serial.setAntialiasing(true);
+    threaded.setAntialiasing(true);
+    threaded.setThreadCount(4);
+    CHECK(sameFrames(serial, threaded, 4));
+}
@@ -0,0 +1,146 @@
+#include <csignal>
+#include <string>
+
+#include "ascii_renderer.h"
+#include "earth.h"
+#include "frame_encoder.h"
+#include "render_loop.h"
+#include "terminal.h"
+#include "test.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+TEST(frameBufferResizesInPlace) {
+    FrameBuffer frame(100, 40);
+    const char* glyphs = frame.glyphs.data();
+    frame.resize(50, 20);
+    frame.resize(100, 40);
+    CHECK(frame.glyphs.data() == glyphs);
+    CHECK_EQ(frame.glyphs.size(), 4000u);
+
+    // Growing doubles, so the next few sizes up fit without another allocation
+    frame.resize(110, 40);
+    CHECK(frame.glyphs.capacity() >= 8000u);
+    CHECK(frame.depth.capacity() >= 8000u);
+    glyphs = frame.glyphs.data();
+    frame.resize(200, 40);
+    CHECK(frame.glyphs.data() == glyphs);
+    CHECK_EQ(frame.depth.size(), 8000u);
+}
+
+TEST(resizedRendererMatchesFreshOne) {
+    ASCIIRenderer resized(150, 50, true);
+    resized.setAntialiasing(true);
+    resized.setGeometryCache(true);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    resized.render(earth);
+    resized.resize(90, 30);
+    resized.render(earth);
+
+    ASCIIRenderer fresh(90, 30, true);
+    fresh.setAntialiasing(true);
+    fresh.setGeometryCache(true);
+    fresh.render(earth);
+    CHECK_EQ(resized.getFrame().width, 90);
+    CHECK_NEAR(resized.getCamera().aspectRatio, fresh.getCamera().aspectRatio, 1e-12);
+    CHECK(resized.getFrame().glyphs == fresh.getFrame().glyphs);
+    CHECK(resized.getFrame().colors == fresh.getFrame().colors);
+
+    // and the banner follows the width
+    std::string encoded = resized.encodeFrame();
+    CHECK(encoded.find(ASCIIRenderer::makeBanner(90, true)) != std::string::npos);
+}
+
+TEST(renderScaleStretchesToTheOutput) {
+    ASCIIRenderer renderer(120, 40, true);
+    renderer.setRenderScale(0.5);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    renderer.render(earth);
+    const FrameBuffer& small = renderer.getFrame();
+    CHECK_EQ(small.width, 60);
+    CHECK_EQ(small.height, 20);
+
+    FrameBuffer out;
+    renderer.swapFrame(out);
+    CHECK_EQ(out.width, 120);
+    CHECK_EQ(out.height, 40);
+    for (int y = 0; y < out.height; y++) {
+        for (int x = 0; x < out.width; x++) {
+            CHECK_EQ(out.glyphs[out.index(x, y)], small.glyphs[small.index(x / 2, y / 2)]);
+        }
+    }
+    CHECK(renderer.getOutputFrame().glyphs == out.glyphs);
+
+    // Back to full size it's the plain render again
+    renderer.setRenderScale(1.0);
+    renderer.render(earth);
+    ASCIIRenderer plain(120, 40, true);
+    plain.render(earth);
+    CHECK(renderer.getFrame().glyphs == plain.getFrame().glyphs);
+}
+
+TEST(scaledIncrementalDeltaSendsOnlyTheFootprint) {
+    ASCIIRenderer renderer(150, 50, true);
+    renderer.setIncremental(true);
+    renderer.setRenderScale(0.6);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    FrameEncoder tagged, plain;
+    tagged.setDeltaMode(true);
+    plain.setDeltaMode(true);
+    FrameBuffer out;
+    for (int frame = 0; frame < 5; frame++) {
+        earth.rotationY = frame * 0.03;
+        renderer.render(earth);
+        renderer.swapFrame(out);
+        FrameView view = out.view();
+        std::string withRect = tagged.encode(view, true, "");
+        view.backgroundKey = 0;
+        CHECK(withRect == plain.encode(view, true, ""));
+        if (frame > 0) CHECK(out.dirty != out.fullRect());
+    }
+}
+
+TEST(dynamicResolutionFollowsTheBudget) {
+    ASCIIRenderer renderer(120, 40, true);
+    Earth earth(3.0, Vec3(0, 0, 0));
+    // Nothing renders in a microsecond, the scale goes down to the floor
+    renderer.setResolutionBudget(1.0, 0.3);
+    for (int frame = 0; frame < 200 && renderer.getRenderScale() > 0.3; frame++) renderer.render(earth);
+    CHECK_NEAR(renderer.getRenderScale(), 0.3, 1e-9);
+    CHECK_EQ(renderer.getFrame().width, 36);
+    CHECK_EQ(renderer.getOutputFrame().width, 120);
+
+    // With time to spare it climbs back to full size
+    renderer.setResolutionBudget(1e9);
+    for (int frame = 0; frame < 200 && renderer.getRenderScale() < 1.0; frame++) renderer.render(earth);
+    CHECK_NEAR(renderer.getRenderScale(), 1.0, 1e-9);
+    CHECK_EQ(renderer.getFrame().width, 120);
+}
+
+TEST(terminalSizeAndResizeSignal) {
+    int width, height;
+    RenderLoop::frameSizeForTerminal(100, 40, 7, width, height);
+    CHECK_EQ(width, 100);
+    CHECK_EQ(height, 33);
+    RenderLoop::frameSizeForTerminal(4, 3, 7, width, height);
+    CHECK_EQ(width, 10);
+    CHECK_EQ(height, 5);
+#ifndef _WIN32
+    // A pipe is no terminal
+    int columns = 0, rows = 0;
+    int fds[2];
+    CHECK_EQ(pipe(fds), 0);
+    CHECK(!queryTerminalSize(fds[0], columns, rows));
+    close(fds[0]);
+    close(fds[1]);
+
+    watchTerminalResize();
+    takeTerminalResize();
+    CHECK(!takeTerminalResize());
+    std::raise(SIGWINCH);
+    CHECK(takeTerminalResize());
+    CHECK(!takeTerminalResize());
+#endif
+}
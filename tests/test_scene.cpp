@@ -0,0 +1,94 @@
+#include "ascii_renderer.h"
+#include "scene.h"
+#include "test.h"
+
+namespace {
+
+Scene makeScene(int debris) {
+    Scene scene;
+    scene.addBody(Earth(3.0, Vec3(0, 0, 0)));
+    Earth moon(0.8, Vec3(), 30, 60, 99);
+    moon.cloudy = false;
+    scene.addBody(moon, Scene::Orbit(Vec3(), 5.0, 0.2, 1.0, 0.3), 0.2);
+    addDebrisField(scene, debris, 3.5, 5.5);
+    scene.animate(0.4);
+    return scene;
+}
+
+// Both queries over a grid of camera rays, they have to agree on body and depth
+int countDisagreements(const Scene& scene) {
+    Camera camera(Vec3(0, 2, -9), Vec3(0, 0, 0), Vec3(0, 1, 0), 45.0, 1.2);
+    int disagreements = 0;
+    for (int y = 0; y < 60; y++) {
+        for (int x = 0; x < 90; x++) {
+            Vec3 dir = camera.rayDirection(x / 45.0 - 1.0, 1.0 - y / 30.0);
+            Scene::Hit a, b;
+            bool hitA = scene.intersect(camera.position, dir, a);
+            bool hitB = scene.intersectLinear(camera.position, dir, b);
+            if (hitA != hitB || (hitA && (a.body != b.body || std::fabs(a.depth - b.depth) > 1e-12))) disagreements++;
+        }
+    }
+    return disagreements;
+}
+
+}  // namespace
+
+TEST(bvhClosestHitMatchesLinear) {
+    Scene scene = makeScene(800);
+    CHECK_EQ(scene.getBodyCount(), 802);
+    CHECK_EQ(countDisagreements(scene), 0);
+}
+
+TEST(bvhRefitFollowsMovingBodies) {
+    Scene scene = makeScene(300);
+    scene.setRebuildInterval(1000);  // refit only
+    for (int step = 1; step <= 20; step++) {
+        scene.animate(0.4 + step * 0.25);
+        CHECK_EQ(countDisagreements(scene), 0);
+    }
+}
+
+TEST(bvhTestsFewSpheres) {
+    Scene scene;
+    addDebrisField(scene, 4000, 3.5, 5.5);
+    scene.animate(0.0);
+    // A ray through the ring should only get to a handful of the 4000 spheres
+    int tests = 0;
+    double tMax = 1e300;
+    scene.getBvh().traverse(Vec3(0, 0, -9), Vec3(0.45, 0.0, 1.0).normalize(), tMax, [&](int, double&) {
+        tests++;
+        return false;
+    });
+    CHECK(tests > 0);
+    CHECK(tests < 200);
+}
+
+TEST(singleBodySceneMatchesGlobe) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    earth.rotationY = 2.1;
+    Scene scene;
+    scene.addBody(earth);
+    scene.update();
+
+    ASCIIRenderer globe(150, 50);
+    ASCIIRenderer sceneRenderer(150, 50);
+    globe.clearBuffers();
+    globe.renderSurface(earth);
+    sceneRenderer.clearBuffers();
+    sceneRenderer.renderSurface(scene);
+    CHECK(globe.getFrame().glyphs == sceneRenderer.getFrame().glyphs);
+    CHECK(globe.getFrame().colors == sceneRenderer.getFrame().colors);
+}
+
+TEST(sceneOcclusionPicksNearestBody) {
+    Scene scene;
+    scene.addBody(Earth(3.0, Vec3(0, 0, 0)));
+    scene.addBody(Earth(0.5, Vec3(0, 0, -5), 8, 16, 5));
+    scene.update();
+    Scene::Hit hit;
+    CHECK(scene.intersect(Vec3(0, 0, -8), Vec3(0, 0, 1), hit));
+    CHECK_EQ(hit.body, 1);
+    CHECK_NEAR(hit.depth, 2.5, 1e-12);
+    CHECK(scene.intersect(Vec3(0, 0, -8), Vec3(0.2, 0, 1).normalize(), hit));
+    CHECK_EQ(hit.body, 0);
+}
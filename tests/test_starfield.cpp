@@ -0,0 +1,129 @@
+#include <limits>
+
+#include "ascii_renderer.h"
+#include "random.h"
+#include "starfield.h"
+#include "test.h"
+
+namespace {
+
+int countStars(const FrameBuffer& frame) {
+    int stars = 0;
+    for (size_t i = 0; i < frame.glyphs.size(); i++) stars += frame.glyphs[i] == '.' || frame.glyphs[i] == '+';
+    return stars;
+}
+
+}  // namespace
+
+TEST(splitMixIsCounterBased) {
+    SplitMix a(7), b(7);
+    for (uint64_t n = 0; n < 100; n++) {
+        uint64_t value = a.next();
+        CHECK_EQ(value, b.next());
+        CHECK_EQ(value, splitMix64(7 + n * 0x9e3779b97f4a7c15ull));
+    }
+    SplitMix c(7);
+    for (int n = 0; n < 1000; n++) {
+        int i = c.nextInt(10);
+        double d = c.nextDouble();
+        CHECK(i >= 0 && i < 10);
+        CHECK(d >= 0.0 && d < 1.0);
+    }
+}
+
+TEST(starfieldSameSeedSameSky) {
+    FrameBuffer a(150, 50), b(150, 50);
+    Starfield first(3), second(3);
+    first.draw(a, 0);
+    second.draw(b, 17);  // without twinkle the frame number doesn't matter
+    CHECK(a.glyphs == b.glyphs);
+    CHECK_EQ(first.getStarCount(), 75u);
+    CHECK(countStars(a) > 60);
+
+    // and it stays put from frame to frame
+    first.draw(a, 1);
+    CHECK(a.glyphs == b.glyphs);
+
+    Starfield other(4);
+    FrameBuffer c(150, 50);
+    other.draw(c, 0);
+    CHECK(a.glyphs != c.glyphs);
+}
+
+TEST(starfieldSkipsDrawnCells) {
+    FrameBuffer frame(40, 20);
+    for (size_t i = 0; i < frame.glyphs.size(); i++) {
+        frame.glyphs[i] = '#';
+        frame.depth[i] = 1.0f;
+    }
+    Starfield stars;
+    stars.draw(frame, 0);
+    CHECK_EQ(countStars(frame), 0);
+}
+
+TEST(starfieldTwinkleIsReproducible) {
+    Starfield first(9), second(9);
+    first.setTwinkle(true);
+    second.setTwinkle(true);
+    FrameBuffer a(200, 60), b(200, 60);
+    bool changed = false;
+    std::vector<char> previous;
+    for (uint32_t n = 0; n < 8; n++) {
+        a.clear();
+        b.clear();
+        first.draw(a, n);
+        second.draw(b, n);
+        CHECK(a.glyphs == b.glyphs);
+        if (n > 0 && a.glyphs != previous) changed = true;
+        previous = a.glyphs;
+    }
+    CHECK(changed);
+}
+
+TEST(starfieldFollowsResize) {
+    Starfield stars;
+    FrameBuffer small(50, 20), large(300, 100);
+    stars.draw(small, 0);
+    CHECK_EQ(stars.getStarCount(), 10u);
+    stars.draw(large, 0);
+    CHECK_EQ(stars.getStarCount(), 300u);
+}
+
+TEST(cityLightsOnlyOnLand) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    int cities = 0;
+    for (int latT = 0; latT < 180; latT++) {
+        for (int lonT = 0; lonT < 360; lonT++) {
+            if (!earth.cityLights.get(latT, lonT)) continue;
+            cities++;
+            CHECK(earth.texture.get(latT, lonT));
+        }
+    }
+    CHECK(cities > 0);
+
+    Earth same(3.0, Vec3(0, 0, 0));
+    Earth other(3.0, Vec3(0, 0, 0), 180, 360, 7);
+    int matches = 0, otherMatches = 0;
+    for (int latT = 0; latT < 180; latT++) {
+        for (int lonT = 0; lonT < 360; lonT++) {
+            matches += earth.cityLights.get(latT, lonT) == same.cityLights.get(latT, lonT);
+            otherMatches += earth.cityLights.get(latT, lonT) == other.cityLights.get(latT, lonT);
+        }
+    }
+    CHECK_EQ(matches, 180 * 360);
+    CHECK(otherMatches < 180 * 360);
+}
+
+// No global random state left, two renderers agree on every cell including the night side
+TEST(renderersAgreeWithoutSharedState) {
+    Earth earth(3.0, Vec3(0, 0, 0));
+    earth.rotationY = 2.5;
+    ASCIIRenderer first(150, 50), second(150, 50);
+    second.setThreadCount(4);
+    for (int frame = 0; frame < 3; frame++) {
+        first.render(earth);
+        second.render(earth);
+        CHECK(first.getFrame().glyphs == second.getFrame().glyphs);
+        CHECK(first.getFrame().colors == second.getFrame().colors);
+    }
+}